@@ -84,7 +84,7 @@
 #define configUSE_RECURSIVE_MUTEXES     1
 #define configCHECK_FOR_STACK_OVERFLOW  0 /* Do not use this option on the PC port. */
 #define configUSE_APPLICATION_TASK_TAG  1
-#define configQUEUE_REGISTRY_SIZE       0
+#define configQUEUE_REGISTRY_SIZE       16
 #define configMAX_SYSCALL_INTERRUPT_PRIORITY    1
 
 #define configUSE_TIMERS                1
@@ -96,7 +96,16 @@
 #define configMAX_PRIORITIES        ( 10 )
 #define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
 
+/* Preallocated game tasks and semaphores, enabled through the CMake
+ option STATIC_ALLOCATION. */
+#ifndef configSUPPORT_STATIC_ALLOCATION
 #define configSUPPORT_STATIC_ALLOCATION     0
+#endif
+
+/* Stop the tick while idle, enabled through the CMake option TICKLESS_IDLE. */
+#ifndef configUSE_TICKLESS_IDLE
+#define configUSE_TICKLESS_IDLE             0
+#endif
 
 /* Set the following definitions to 1 to include the API function, or zero
  to exclude the API function. */
@@ -112,9 +121,38 @@
 #define INCLUDE_uxTaskGetStackHighWaterMark 0 /* Do not use this option on the PC port. */
 #define INCLUDE_xTaskGetSchedulerState      1
 
-extern void vMainQueueSendPassed(void);
-#define traceQUEUE_SEND( pxQueue ) vMainQueueSendPassed()
-
 #define configGENERATE_RUN_TIME_STATS       1
 
+/* Per task switch and blocking statistics, see task_stats.h. Tools that
+ link the kernel without lib/tracer build with configUSE_TASK_STATS=0. */
+#ifndef configUSE_TASK_STATS
+#define configUSE_TASK_STATS                1
+#endif
+
+/* Scheduler event trace, enabled through the CMake option SCHED_TRACE. */
+#ifndef configUSE_SCHED_TRACE
+#define configUSE_SCHED_TRACE               0
+#endif
+
+/* Semaphore contention profile, enabled through the CMake option
+ LOCK_PROFILE, see lock_prof.h. */
+#ifndef configUSE_LOCK_PROFILE
+#define configUSE_LOCK_PROFILE              0
+#endif
+
+/* Input to present latency histograms, enabled through the CMake option
+ INPUT_LATENCY, see input_latency.h. */
+#ifndef configUSE_INPUT_LATENCY
+#define configUSE_INPUT_LATENCY             0
+#endif
+
+/* Per frame CPU time of profiling zones, enabled through the CMake option
+ PROF_ZONES, see prof_zone.h. */
+#ifndef configUSE_PROF_ZONES
+#define configUSE_PROF_ZONES                0
+#endif
+
+/* The trace hook macros are collected in one place. */
+#include "trace_hooks.h"
+
 #endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,97 @@
+#ifndef TRACE_HOOKS_H
+#define TRACE_HOOKS_H
+
+/*-----------------------------------------------------------
+ * Kernel trace hook macros, included at the end of FreeRTOSConfig.h.
+ *
+ * The hooks expand inside tasks.c and queue.c, so they may refer to
+ * pxCurrentTCB and pxQueue. Every consumer defines its part of a hook
+ * as a tracePART_... macro that is empty when the consumer is disabled,
+ * the trace... macros below chain the parts.
+ *----------------------------------------------------------*/
+
+extern void vMainQueueSendPassed(void);
+
+/* Per task switch and blocking statistics, see task_stats.h. */
+#if (configUSE_TASK_STATS == 1)
+#define TASK_STATS_PREEMPTED    0
+#define TASK_STATS_BLOCKED      1
+#define TASK_STATS_SUSPENDED    2
+
+extern void vTaskStatsSwitchedIn(unsigned long ulTaskNumber);
+extern void vTaskStatsSwitchedOut(unsigned long ulTaskNumber, int iReason);
+
+/* Tells apart a task that was preempted or yielded (still ready), one that
+ blocks on a delay or an event and one that was suspended. */
+#define tracePART_STATS_SWITCHED_IN() \
+    vTaskStatsSwitchedIn(pxCurrentTCB->uxTCBNumber)
+#define tracePART_STATS_SWITCHED_OUT() \
+    vTaskStatsSwitchedOut(pxCurrentTCB->uxTCBNumber, \
+        listIS_CONTAINED_WITHIN(&(pxReadyTasksLists[pxCurrentTCB->uxPriority]), \
+                                &(pxCurrentTCB->xStateListItem)) ? TASK_STATS_PREEMPTED : \
+        (listIS_CONTAINED_WITHIN(&xSuspendedTaskList, \
+                                 &(pxCurrentTCB->xStateListItem)) && \
+         listLIST_ITEM_CONTAINER(&(pxCurrentTCB->xEventListItem)) == NULL) ? \
+            TASK_STATS_SUSPENDED : TASK_STATS_BLOCKED)
+#else
+#define tracePART_STATS_SWITCHED_IN()
+#define tracePART_STATS_SWITCHED_OUT()
+#endif
+
+/* Scheduler event trace exported as Chrome JSON, see sched_trace.h. */
+#if (configUSE_SCHED_TRACE == 1)
+#define SCHED_EVENT_SWITCHED_IN     0
+#define SCHED_EVENT_SWITCHED_OUT    1
+#define SCHED_EVENT_TICK            2
+#define SCHED_EVENT_SEND            3
+#define SCHED_EVENT_SEND_FAILED     4
+#define SCHED_EVENT_BLOCK_ON_SEND   5
+#define SCHED_EVENT_RECEIVE         6
+#define SCHED_EVENT_RECEIVE_FAILED  7
+#define SCHED_EVENT_BLOCK_ON_RECEIVE 8
+#define SCHED_EVENT_SEND_FROM_ISR   9
+#define SCHED_EVENT_RECEIVE_FROM_ISR 10
+
+extern void vSchedTraceSwitchedIn(unsigned long ulTaskNumber, const char *pcName);
+extern void vSchedTraceSwitchedOut(unsigned long ulTaskNumber);
+extern void vSchedTraceTick(unsigned long ulTickCount);
+extern void vSchedTraceQueue(int iEvent, void *pvQueue, unsigned char ucQueueType);
+
+/* traceTASK_CREATE is taken by the port, names are picked up on the first
+ switch in instead. */
+#define tracePART_SCHED_SWITCHED_IN() \
+    vSchedTraceSwitchedIn(pxCurrentTCB->uxTCBNumber, pxCurrentTCB->pcTaskName)
+#define tracePART_SCHED_SWITCHED_OUT() \
+    vSchedTraceSwitchedOut(pxCurrentTCB->uxTCBNumber)
+#define tracePART_SCHED_QUEUE(iEvent, pxQueue) \
+    vSchedTraceQueue(iEvent, pxQueue, (pxQueue)->ucQueueType)
+
+#define traceTASK_INCREMENT_TICK(xTickCount) vSchedTraceTick(xTickCount)
+#define traceQUEUE_SEND_FAILED(pxQueue) \
+    tracePART_SCHED_QUEUE(SCHED_EVENT_SEND_FAILED, pxQueue)
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue) \
+    tracePART_SCHED_QUEUE(SCHED_EVENT_BLOCK_ON_SEND, pxQueue)
+#define traceQUEUE_RECEIVE(pxQueue) \
+    tracePART_SCHED_QUEUE(SCHED_EVENT_RECEIVE, pxQueue)
+#define traceQUEUE_RECEIVE_FAILED(pxQueue) \
+    tracePART_SCHED_QUEUE(SCHED_EVENT_RECEIVE_FAILED, pxQueue)
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) \
+    tracePART_SCHED_QUEUE(SCHED_EVENT_BLOCK_ON_RECEIVE, pxQueue)
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) \
+    tracePART_SCHED_QUEUE(SCHED_EVENT_SEND_FROM_ISR, pxQueue)
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue) \
+    tracePART_SCHED_QUEUE(SCHED_EVENT_RECEIVE_FROM_ISR, pxQueue)
+#else
+#define tracePART_SCHED_SWITCHED_IN()
+#define tracePART_SCHED_SWITCHED_OUT()
+#define tracePART_SCHED_QUEUE(iEvent, pxQueue)
+#endif
+
+#define traceTASK_SWITCHED_IN() \
+    do { tracePART_STATS_SWITCHED_IN(); tracePART_SCHED_SWITCHED_IN(); } while (0)
+#define traceTASK_SWITCHED_OUT() \
+    do { tracePART_SCHED_SWITCHED_OUT(); tracePART_STATS_SWITCHED_OUT(); } while (0)
+#define traceQUEUE_SEND(pxQueue) \
+    do { vMainQueueSendPassed(); tracePART_SCHED_QUEUE(SCHED_EVENT_SEND, pxQueue); } while (0)
+
+#endif /* TRACE_HOOKS_H */
@@ -36,6 +36,8 @@
 #include <stdint.h>
 #include <string.h>
 #include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
 
 #include "AsyncIO.h"
 
@@ -43,7 +45,8 @@
 	fprintf(stderr, "[ERRNO: %s] %s:%d -> %s\n", strerror(errno),          \
 		__FILE__, __LINE__, __func__);
 
-void *aIOTCPHandler(void *conn);
+/** Max. number of epoll events a TCP worker handles per wakeup */
+#define AIO_TCP_MAX_EVENTS 32
 
 typedef enum {
 	NONE = 0,
@@ -87,6 +90,7 @@ typedef struct aIO {
 	void (*callback)(size_t, char *, void *);
 	void *args;
 	struct aIO *next;
+	struct aIO *prev;
 
 	pthread_mutex_t lock;
 } aIO_t;
@@ -94,63 +98,219 @@ typedef struct aIO {
 typedef struct {
 	int client_fd;
 	size_t buffer_size;
+	char *buffer;
 
 	void (*callback)(size_t, char *, void *);
 	void *args;
 } aIO_tcp_client;
 
+typedef struct {
+	pthread_t thread;
+	int epoll_fd;
+} aIO_tcp_worker;
+
 aIO_t head = { .type = NONE, .lock = PTHREAD_MUTEX_INITIALIZER };
 pthread_cond_t aIO_quit_conn = PTHREAD_COND_INITIALIZER;
 pthread_mutex_t aIO_quit_lock = PTHREAD_MUTEX_INITIALIZER;
 
-aIO_t *getLastConnection(void)
+static aIO_tcp_worker *tcp_workers = NULL;
+static unsigned int tcp_worker_count = AIO_TCP_WORKERS;
+static unsigned int tcp_next_worker = 0;
+static pthread_mutex_t tcp_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int aIOTCPDispatchClient(int client_fd, aIO_t *conn);
+
+/**
+ * Connections are indexed by their socket fd or message queue descriptor in an
+ * open addressing table. Lookups, e.g. from the SIGIO and MQ notification
+ * handlers, only perform atomic loads and never take a lock; insertions and
+ * removals are serialized by registry_lock. Removed entries are replaced by a
+ * tombstone so that probe chains stay intact for concurrent readers.
+ *
+ * Readers count themselves in registry_readers for as long as they use a
+ * connection they looked up. Closed connections are retired and only freed
+ * once no reader is counted, a reader starting later can no longer find
+ * them.
+ */
+#define AIO_REGISTRY_MASK (AIO_REGISTRY_SIZE - 1)
+
+static aIO_t registry_tombstone;
+#define AIO_TOMBSTONE (&registry_tombstone)
+
+static aIO_t *registry_fds[AIO_REGISTRY_SIZE] = { 0 };
+static aIO_t *tail = &head;
+static pthread_mutex_t registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static aIO_t *retired = NULL;
+static unsigned int registry_readers = 0;
+
+static unsigned int hashFd(int fd)
 {
-	aIO_t *iterator;
+	return ((unsigned int)fd * 2654435761u) & AIO_REGISTRY_MASK;
+}
+
+static int connectionFd(aIO_t *conn)
+{
+	switch (conn->type) {
+	case SOCKET:
+		return conn->attr.socket.fd;
+	case MSG_QUEUE:
+		return (int)conn->attr.mq.fd;
+	default:
+		return -1;
+	}
+}
 
-	for (iterator = &head; iterator->next; iterator = iterator->next) {
-		;
+static int registryInsert(aIO_t **table, unsigned int slot, aIO_t *conn)
+{
+	unsigned int i;
+	aIO_t *entry;
+
+	for (i = 0; i < AIO_REGISTRY_SIZE; i++) {
+		entry = table[(slot + i) & AIO_REGISTRY_MASK];
+		if (entry == NULL || entry == AIO_TOMBSTONE) {
+			__atomic_store_n(&table[(slot + i) & AIO_REGISTRY_MASK],
+					 conn, __ATOMIC_RELEASE);
+			return 0;
+		}
 	}
 
-	return iterator;
+	return -1;
 }
 
-static aIO_t *findConnection(aIO_conn_e type, void *arg)
+static void registryRemove(aIO_t **table, unsigned int slot, aIO_t *conn)
 {
-	aIO_t *prev = &head;
-	aIO_t *curr;
-
-	pthread_mutex_lock(&prev->lock);
-	while ((curr = prev->next) != NULL) {
-		pthread_mutex_lock(&curr->lock);
-		switch (type) {
-		case SOCKET:
-			if (curr->type == type) {
-				if (curr->attr.socket.fd == *(int *)arg) {
-					pthread_mutex_unlock(&prev->lock);
-					pthread_mutex_unlock(&curr->lock);
-					return curr;
-				}
-			}
-			break;
-		//TODO
-		case MSG_QUEUE:
-		case SERIAL:
-		case NONE:
-		default:
-			pthread_mutex_unlock(&prev->lock);
-			pthread_mutex_unlock(&curr->lock);
-			return NULL;
+	unsigned int i;
+	aIO_t *entry;
+
+	for (i = 0; i < AIO_REGISTRY_SIZE; i++) {
+		entry = table[(slot + i) & AIO_REGISTRY_MASK];
+		if (entry == NULL)
+			return;
+		if (entry == conn) {
+			__atomic_store_n(&table[(slot + i) & AIO_REGISTRY_MASK],
+					 AIO_TOMBSTONE, __ATOMIC_RELEASE);
+			return;
 		}
-		pthread_mutex_unlock(&prev->lock);
-		prev = curr;
 	}
-	pthread_mutex_unlock(&prev->lock);
+}
+
+static int registerConnection(aIO_t *conn)
+{
+	int ret = -1;
+
+	pthread_mutex_lock(&registry_lock);
+
+	if (connectionFd(conn) >= 0)
+		ret = registryInsert(registry_fds, hashFd(connectionFd(conn)),
+				     conn);
+
+	if (ret) {
+		fprintf(stderr, "Connection registry full\n");
+		goto out;
+	}
+
+	conn->prev = tail;
+	tail->next = conn;
+	tail = conn;
+
+out:
+	pthread_mutex_unlock(&registry_lock);
+	return ret;
+}
+
+static void unregisterConnection(aIO_t *conn)
+{
+	pthread_mutex_lock(&registry_lock);
+
+	if (connectionFd(conn) >= 0)
+		registryRemove(registry_fds, hashFd(connectionFd(conn)), conn);
+
+	if (conn->prev) {
+		conn->prev->next = conn->next;
+		if (conn->next)
+			conn->next->prev = conn->prev;
+		else
+			tail = conn->prev;
+		conn->prev = NULL;
+		conn->next = NULL;
+	}
+
+	pthread_mutex_unlock(&registry_lock);
+}
+
+static aIO_t *findConnection(aIO_conn_e type, int fd)
+{
+	unsigned int slot, i;
+	aIO_t *entry;
+
+	switch (type) {
+	case SOCKET:
+	case MSG_QUEUE:
+		slot = hashFd(fd);
+		for (i = 0; i < AIO_REGISTRY_SIZE; i++) {
+			entry = __atomic_load_n(
+				&registry_fds[(slot + i) & AIO_REGISTRY_MASK],
+				__ATOMIC_ACQUIRE);
+			if (entry == NULL)
+				return NULL;
+			if (entry != AIO_TOMBSTONE && entry->type == type &&
+			    connectionFd(entry) == fd)
+				return entry;
+		}
+		break;
+	//TODO
+	case SERIAL:
+	case NONE:
+	default:
+		break;
+	}
+
 	return NULL;
 }
 
 //TODO move this into functions that are calable such that connections can be
 //closed during runtime
 
+static void freeConnection(aIO_t *conn)
+{
+	if (conn->type == MSG_QUEUE)
+		free(conn->attr.mq.name);
+	free(conn->buffer);
+	free(conn);
+}
+
+static void freeRetiredConnections(void)
+{
+	aIO_t *list, *conn;
+
+	pthread_mutex_lock(&registry_lock);
+	/** Orders the removal from the tables before checking for readers */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&registry_readers, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_unlock(&registry_lock);
+		return;
+	}
+	list = retired;
+	retired = NULL;
+	pthread_mutex_unlock(&registry_lock);
+
+	while (list) {
+		conn = list;
+		list = list->next;
+		freeConnection(conn);
+	}
+}
+
+static void retireConnection(aIO_t *conn)
+{
+	pthread_mutex_lock(&registry_lock);
+	conn->next = retired;
+	retired = conn;
+	pthread_mutex_unlock(&registry_lock);
+
+	freeRetiredConnections();
+}
+
 void aIOCloseConn(aIO_handle_t conn)
 {
 	if (conn == NULL) {
@@ -161,6 +321,8 @@ void aIOCloseConn(aIO_handle_t conn)
 
 	aIO_t *del = (aIO_t *)conn;
 
+	unregisterConnection(del);
+
 	switch (del->type) {
 	case SOCKET:
 		printf("Deinit socket %d\n",
@@ -170,16 +332,13 @@ void aIOCloseConn(aIO_handle_t conn)
 			PRINT_CHECK;
 			return;
 		}
-		free(del->buffer);
-		free(del);
+		retireConnection(del);
 		break;
 	case MSG_QUEUE:
 		printf("Deinit MQ %s\n", del->attr.mq.name);
 		mq_close(del->attr.mq.fd);
 		mq_unlink(del->attr.mq.name);
-		free(del->attr.mq.name);
-		free(del->buffer);
-		free(del);
+		retireConnection(del);
 		break;
 	default:
 		break;
@@ -191,13 +350,17 @@ void aIODeinit(void)
 	aIO_t *iterator;
 	aIO_t *del;
 
-	if (head.next) {
-		for (iterator = head.next; iterator;) {
-			del = iterator;
-			iterator = iterator->next;
-			aIOCloseConn((aIO_handle_t)del);
-		}
+	for (iterator = head.next; iterator;) {
+		del = iterator;
+		iterator = iterator->next;
+		aIOCloseConn((aIO_handle_t)del);
 	}
+
+	/** Connections closed while a handler was running are still retired */
+	/**     and no handler can find them anymore, wait for the readers */
+	while (__atomic_load_n(&registry_readers, __ATOMIC_SEQ_CST))
+		sched_yield();
+	freeRetiredConnections();
 }
 
 aIO_t *createAsyncIO(aIO_conn_e type, size_t buffer_size,
@@ -241,19 +404,31 @@ err_aio:
 
 static void aIOMQSigHandler(union sigval sv)
 {
-	aIO_t *conn = (aIO_t *)sv.sival_ptr;
+	ssize_t bytes_read;
+	aIO_t *conn;
+
+	/** Keeps the connection from being freed while it is used */
+	__atomic_fetch_add(&registry_readers, 1, __ATOMIC_SEQ_CST);
 
-	ssize_t bytes_read = mq_receive(conn->attr.mq.fd, conn->buffer,
-					conn->buffer_size, NULL);
+	/** The MQ may have been closed since the notification was sent */
+	conn = findConnection(MSG_QUEUE, sv.sival_int);
+	if (conn == NULL)
+		goto out;
+
+	bytes_read = mq_receive(conn->attr.mq.fd, conn->buffer,
+				conn->buffer_size, NULL);
 
 	if (bytes_read > 0)
 		(conn->callback)(bytes_read, conn->buffer, conn->args);
 
-	/** reprime MQ notifications */
-	if (mq_notify(conn->attr.mq.fd, &conn->attr.mq.ev)) {
+	/** reprime MQ notifications unless the MQ was closed meanwhile */
+	if (findConnection(MSG_QUEUE, sv.sival_int) == conn &&
+	    mq_notify(conn->attr.mq.fd, &conn->attr.mq.ev)) {
 		fprintf(stderr, "Failed to notify MQ '%s'", conn->attr.mq.name);
 		PRINT_CHECK;
 	}
+out:
+	__atomic_fetch_sub(&registry_readers, 1, __ATOMIC_RELEASE);
 }
 
 int aIOMessageQueuePut(char *mq_name, char *buffer)
@@ -351,17 +526,15 @@ aIO_handle_t aIOOpenMessageQueue(char *name, long max_msg_num,
 				 void (*callback)(size_t, char *, void *),
 				 void *args)
 {
-	aIO_t *conn = getLastConnection();
-
-	conn->next = createAsyncIO(MSG_QUEUE, max_msg_size, callback, args);
-	if (conn->next == NULL) {
+	aIO_t *conn = createAsyncIO(MSG_QUEUE, max_msg_size, callback, args);
+	if (conn == NULL) {
 		fprintf(stderr, "Failed to allocate MQ IO for MQ '%s'\n", name);
 		goto error_IO;
 	}
 
-	pthread_mutex_lock(&conn->next->lock);
+	pthread_mutex_lock(&conn->lock);
 
-	aIO_mq_t *mq = &conn->next->attr.mq;
+	aIO_mq_t *mq = &conn->attr.mq;
 
 	size_t str_len = strlen(name);
 
@@ -381,10 +554,6 @@ aIO_handle_t aIOOpenMessageQueue(char *name, long max_msg_num,
 	attr.mq_msgsize = max_msg_size < MQ_MSGSIZE ? max_msg_size : MQ_MSGSIZE;
 	attr.mq_curmsgs = 0;
 
-	/** sigval struct that is passed to handler. sival_ptr is used to pass pointer  */
-	/**     to structure containing MQ information */
-	sv.sival_ptr = conn->next;
-
 	/** Create MQ */
 	if (-1 == (mq->fd = mq_open(mq->name, O_CREAT | O_RDONLY | O_NONBLOCK,
 				    0644, &attr))) {
@@ -392,32 +561,45 @@ aIO_handle_t aIOOpenMessageQueue(char *name, long max_msg_num,
 		goto error_open;
 	}
 
+	/** sigval struct that is passed to handler. sival_int is used to pass */
+	/**     the MQ descriptor the connection is looked up by */
+	sv.sival_int = (int)mq->fd;
+
 	/** sigevent needed to enable to passing of si_value to the handler */
-	conn->next->attr.mq.ev.sigev_notify = SIGEV_THREAD;
+	conn->attr.mq.ev.sigev_notify = SIGEV_THREAD;
 	mq->ev.sigev_signo = SIGIO;
 	mq->ev.sigev_value = sv;
 	/** used by SIGEV_THREAD */
 	mq->ev.sigev_notify_function = aIOMQSigHandler;
 	mq->ev.sigev_notify_attributes = NULL;
 
+	if (registerConnection(conn)) {
+		fprintf(stderr, "Failed to register MQ '%s'\n", mq->name);
+		goto error_register;
+	}
+
 	if (mq_notify(mq->fd, &mq->ev)) {
 		fprintf(stderr, "Failed to notify MQ '%s'\n", mq->name);
 		goto error_notify;
 	}
 
-	pthread_mutex_unlock(&conn->next->lock);
+	pthread_mutex_unlock(&conn->lock);
 
 	printf("MQ '%s' opened and notified\n", name);
 
-	return (aIO_handle_t)conn->next;
+	return (aIO_handle_t)conn;
 
 error_notify:
+	unregisterConnection(conn);
+error_register:
+	mq_close(mq->fd);
+	mq_unlink(mq->name);
 error_open:
 	free(mq->name);
 error_name:
-	free(conn->next);
-	conn->next = NULL;
-	pthread_mutex_unlock(&conn->next->lock);
+	pthread_mutex_unlock(&conn->lock);
+	free(conn->buffer);
+	free(conn);
 error_IO:
 	return NULL;
 }
@@ -426,12 +608,16 @@ static void aIOSocketSigHandler(int signal, siginfo_t *info, void *context)
 {
 	ssize_t read_size;
 	int server_fd = info->si_fd;
-	aIO_t *conn = findConnection(SOCKET, &server_fd);
+	aIO_t *conn;
 
+	/** Keeps the connection from being freed while it is used */
+	__atomic_fetch_add(&registry_readers, 1, __ATOMIC_SEQ_CST);
+
+	conn = findConnection(SOCKET, server_fd);
 	if (conn == NULL) {
 		fprintf(stderr, "Failed to find connection");
 		PRINT_CHECK;
-		return;
+		goto out;
 	}
 
 	pthread_mutex_lock(&conn->lock);
@@ -455,50 +641,41 @@ static void aIOSocketSigHandler(int signal, siginfo_t *info, void *context)
 		while ((client_fd =
 				accept(server_fd, (struct sockaddr *)&client,
 				       &client_size)) > 0) {
-			pthread_t handler_thread;
-			aIO_tcp_client *new_client = (aIO_tcp_client *)calloc(1,
-				sizeof(aIO_tcp_client));
-			new_client->client_fd = client_fd;
-			new_client->buffer_size = conn->buffer_size;
-			new_client->callback = conn->callback;
-			new_client->args = conn->args;
-
-			if (pthread_create(&handler_thread, NULL, aIOTCPHandler,
-					   (void *)new_client)) {
+			if (aIOTCPDispatchClient(client_fd, conn)) {
 				fprintf(stderr,
-					"Failed to create TCP handler thread");
+					"Failed to dispatch TCP client\n");
 				PRINT_CHECK;
-				free(new_client);
-				return;
+				close(client_fd);
 			}
 		}
-	} break;
+	}
+		break;
 	default:
 		break;
 	}
 
 	pthread_mutex_unlock(&conn->lock);
+out:
+	__atomic_fetch_sub(&registry_readers, 1, __ATOMIC_RELEASE);
 }
 
 aIO_handle_t aIOOpenUDPSocket(char *s_addr, in_port_t port, size_t buffer_size,
 			      void (*callback)(size_t, char *, void *),
 			      void *args)
 {
-	aIO_t *conn = getLastConnection();
-
-	conn->next = createAsyncIO(SOCKET, buffer_size, callback, args);
-	if (conn->next == NULL) {
+	aIO_t *conn = createAsyncIO(SOCKET, buffer_size, callback, args);
+	if (conn == NULL) {
 		fprintf(stderr,
 			"Failed to allocate UDP IO on port %" PRIu16 "\n",
 			(uint16_t)port);
 		goto error_IO;
 	}
 
-	conn->next->attr.socket.type = UDP;
+	conn->attr.socket.type = UDP;
 
-	pthread_mutex_lock(&conn->next->lock);
+	pthread_mutex_lock(&conn->lock);
 
-	aIO_socket_t *s_udp = &conn->next->attr.socket;
+	aIO_socket_t *s_udp = &conn->attr.socket;
 
 	s_udp->addr.sin_family = AF_INET;
 	s_udp->addr.sin_addr.s_addr =
@@ -546,71 +723,230 @@ aIO_handle_t aIOOpenUDPSocket(char *s_addr, in_port_t port, size_t buffer_size,
 		goto error_fcntl;
 	}
 
+	if (registerConnection(conn)) {
+		fprintf(stderr, "Failed to register socket %" PRIu16 "\n",
+			(uint16_t)port);
+		goto error_fcntl;
+	}
+
 	if (bind(s_udp->fd, (struct sockaddr *)&s_udp->addr,
 		 sizeof(s_udp->addr)) < 0) {
 		fprintf(stderr, "Failed to bind UDP socket %" PRIu16 "\n",
 			(uint16_t)port);
 		PRINT_CHECK;
-		goto error_fcntl;
+		goto error_bind;
 	}
 
-	pthread_mutex_unlock(&conn->next->lock);
+	pthread_mutex_unlock(&conn->lock);
 
-	return (aIO_handle_t)conn->next;
+	return (aIO_handle_t)conn;
 
+error_bind:
+	unregisterConnection(conn);
 error_fcntl:
 	close(s_udp->fd);
 error_socket:
-	free(conn->next);
-	conn->next = NULL;
-	pthread_mutex_unlock(&conn->next->lock);
+	pthread_mutex_unlock(&conn->lock);
+	free(conn->buffer);
+	free(conn);
 error_IO:
 	return NULL;
 }
 
-void *aIOTCPHandler(void *conn)
+static void aIOTCPCloseClient(aIO_tcp_client *client)
+{
+	close(client->client_fd);
+	free(client->buffer);
+	free(client);
+}
+
+static void aIOTCPServiceClient(aIO_tcp_client *client)
 {
 	ssize_t read_size;
-	aIO_tcp_client *client = (aIO_tcp_client *)conn;
-	int client_fd = client->client_fd;
-	char *buffer = (char *)calloc(client->buffer_size, sizeof(char));
-	if (buffer == NULL) {
-		fprintf(stderr, "Failed to handle TCP\n");
-		PRINT_CHECK;
-		return NULL;
-	}
 
-	while ((read_size = recv(client_fd, buffer, client->buffer_size, 0)))
-		if (client->callback) {
-			(client->callback)(read_size, buffer, client->args);
+	while ((read_size = recv(client->client_fd, client->buffer,
+				 client->buffer_size, 0)) > 0)
+		if (client->callback)
+			(client->callback)(read_size, client->buffer,
+					   client->args);
+
+	/** Client still connected, wait for the next epoll event */
+	if (read_size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK ||
+			      errno == EINTR))
+		return;
+
+	/** Closing the fd also removes it from the worker's epoll set */
+	aIOTCPCloseClient(client);
+}
+
+static void *aIOTCPWorker(void *args)
+{
+	aIO_tcp_worker *worker = (aIO_tcp_worker *)args;
+	struct epoll_event events[AIO_TCP_MAX_EVENTS];
+	int i, n;
+
+	while (1) {
+		n = epoll_wait(worker->epoll_fd, events, AIO_TCP_MAX_EVENTS,
+			       -1);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			fprintf(stderr, "TCP worker epoll failed\n");
+			PRINT_CHECK;
+			break;
 		}
 
-	close(client_fd);
-	free(buffer);
-	free((aIO_tcp_client *)conn);
+		for (i = 0; i < n; i++)
+			aIOTCPServiceClient(
+				(aIO_tcp_client *)events[i].data.ptr);
+	}
 
 	return NULL;
 }
 
+static int aIOTCPInitWorkers(void)
+{
+	sigset_t all_signals, old_signals;
+	unsigned int i;
+	int ret = 0;
+
+	pthread_mutex_lock(&tcp_pool_lock);
+
+	if (tcp_workers)
+		goto out;
+
+	tcp_workers = (aIO_tcp_worker *)calloc(tcp_worker_count,
+					       sizeof(aIO_tcp_worker));
+	if (tcp_workers == NULL) {
+		fprintf(stderr, "Failed to allocate TCP workers\n");
+		goto err_alloc;
+	}
+
+	/** Workers must never be picked to run the SIGIO or RTOS handlers */
+	sigfillset(&all_signals);
+	pthread_sigmask(SIG_BLOCK, &all_signals, &old_signals);
+
+	for (i = 0; i < tcp_worker_count; i++) {
+		tcp_workers[i].epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+		if (tcp_workers[i].epoll_fd < 0) {
+			fprintf(stderr, "Failed to create TCP worker epoll\n");
+			goto err_worker;
+		}
+		if (pthread_create(&tcp_workers[i].thread, NULL, aIOTCPWorker,
+				   &tcp_workers[i])) {
+			fprintf(stderr, "Failed to create TCP worker thread\n");
+			close(tcp_workers[i].epoll_fd);
+			goto err_worker;
+		}
+		pthread_detach(tcp_workers[i].thread);
+	}
+
+	pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+	goto out;
+
+err_worker:
+	pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+	PRINT_CHECK;
+	/** Run with the workers that could be started */
+	tcp_worker_count = i;
+	if (i)
+		goto out;
+	free(tcp_workers);
+	tcp_workers = NULL;
+err_alloc:
+	ret = -1;
+out:
+	pthread_mutex_unlock(&tcp_pool_lock);
+	return ret;
+}
+
+int aIOSetTCPWorkerCount(unsigned int count)
+{
+	int ret = -1;
+
+	if (count == 0)
+		return -1;
+
+	pthread_mutex_lock(&tcp_pool_lock);
+	if (tcp_workers == NULL) {
+		tcp_worker_count = count;
+		ret = 0;
+	}
+	pthread_mutex_unlock(&tcp_pool_lock);
+
+	return ret;
+}
+
+static int aIOTCPDispatchClient(int client_fd, aIO_t *conn)
+{
+	struct epoll_event ev = { 0 };
+	aIO_tcp_client *client;
+	aIO_tcp_worker *worker;
+	int fs;
+
+	if (tcp_workers == NULL)
+		return -1;
+
+	client = (aIO_tcp_client *)calloc(1, sizeof(aIO_tcp_client));
+	if (client == NULL)
+		goto err_client;
+
+	client->buffer = (char *)calloc(conn->buffer_size, sizeof(char));
+	if (client->buffer == NULL)
+		goto err_buffer;
+
+	client->client_fd = client_fd;
+	client->buffer_size = conn->buffer_size;
+	client->callback = conn->callback;
+	client->args = conn->args;
+
+	if ((fs = fcntl(client_fd, F_GETFL)) == -1)
+		goto err_fcntl;
+	if (fcntl(client_fd, F_SETFL, fs | O_NONBLOCK) == -1)
+		goto err_fcntl;
+
+	/** Only ever called from the SIGIO handler, round robin is enough */
+	worker = &tcp_workers[tcp_next_worker++ % tcp_worker_count];
+
+	ev.events = EPOLLIN | EPOLLRDHUP;
+	ev.data.ptr = client;
+	if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, client_fd, &ev))
+		goto err_fcntl;
+
+	return 0;
+
+err_fcntl:
+	free(client->buffer);
+err_buffer:
+	free(client);
+err_client:
+	return -1;
+}
+
 aIO_handle_t aIOOpenTCPSocket(char *s_addr, in_port_t port, size_t buffer_size,
 			      void (*callback)(size_t, char *, void *),
 			      void *args)
 {
-	aIO_t *conn = getLastConnection();
+	if (aIOTCPInitWorkers()) {
+		fprintf(stderr,
+			"Failed to start TCP workers for port %" PRIu16 "\n",
+			(uint16_t)port);
+		return NULL;
+	}
 
-	conn->next = createAsyncIO(SOCKET, buffer_size, callback, args);
-	if (conn->next == NULL) {
+	aIO_t *conn = createAsyncIO(SOCKET, buffer_size, callback, args);
+	if (conn == NULL) {
 		fprintf(stderr,
 			"Failed to allocate TCP IO on port %" PRIu16 "\n",
 			(uint16_t)port);
 		goto error_IO;
 	}
 
-	conn->next->attr.socket.type = TCP;
+	conn->attr.socket.type = TCP;
 
-	pthread_mutex_lock(&conn->next->lock);
+	pthread_mutex_lock(&conn->lock);
 
-	aIO_socket_t *s_tcp = &conn->next->attr.socket;
+	aIO_socket_t *s_tcp = &conn->attr.socket;
 
 	s_tcp->addr.sin_family = AF_INET;
 	s_tcp->addr.sin_addr.s_addr = s_addr ? inet_addr(s_addr) : INADDR_ANY;
@@ -667,30 +1003,38 @@ aIO_handle_t aIOOpenTCPSocket(char *s_addr, in_port_t port, size_t buffer_size,
 		goto error_fcntl;
 	}
 
+	if (registerConnection(conn)) {
+		fprintf(stderr, "Failed to register socket %" PRIu16 "\n",
+			(uint16_t)port);
+		goto error_fcntl;
+	}
+
 	if (bind(s_tcp->fd, (struct sockaddr *)&s_tcp->addr,
 		 sizeof(s_tcp->addr)) < 0) {
 		fprintf(stderr, "Failed to bind TCP socket %" PRIu16 "\n",
 			(uint16_t)port);
 		PRINT_CHECK;
-		goto error_fcntl;
+		goto error_bind;
 	}
 
-	if (listen(s_tcp->fd, 1) < 0) {
+	if (listen(s_tcp->fd, SOMAXCONN) < 0) {
 		fprintf(stderr, "Failed to listen on TCP port %" PRIu16 "\n",
 			(uint16_t)port);
-		goto error_fcntl;
+		goto error_bind;
 	}
 
-	pthread_mutex_unlock(&conn->next->lock);
+	pthread_mutex_unlock(&conn->lock);
 
-	return (aIO_handle_t)conn->next;
+	return (aIO_handle_t)conn;
 
+error_bind:
+	unregisterConnection(conn);
 error_fcntl:
 	close(s_tcp->fd);
 error_socket:
-	free(conn->next);
-	conn->next = NULL;
-	pthread_mutex_unlock(&conn->next->lock);
+	pthread_mutex_unlock(&conn->lock);
+	free(conn->buffer);
+	free(conn);
 error_IO:
 	PRINT_CHECK;
 	return NULL;
@@ -47,6 +47,29 @@
 #define MQ_MAXMSG 256
 #define MQ_MSGSIZE 256
 
+/**
+ * @brief Default number of worker threads serving accepted TCP clients
+ *
+ * Accepted TCP clients are multiplexed over a fixed pool of worker threads,
+ * each waiting on its own epoll set, instead of spawning a thread per client.
+ * Can be overridden at compile time or at runtime using
+ * @ref aIOSetTCPWorkerCount.
+ */
+#ifndef AIO_TCP_WORKERS
+#define AIO_TCP_WORKERS 4
+#endif
+
+/**
+ * @brief Max. number of simultaneously open connections
+ *
+ * Open connections are indexed by socket fd or message queue descriptor in a
+ * hash table of this size so that incoming traffic is dispatched in constant
+ * time. Must be a power of two.
+ */
+#ifndef AIO_REGISTRY_SIZE
+#define AIO_REGISTRY_SIZE 256
+#endif
+
 /**
  * @brief Handle used to reference and opened asyncronour communications channel
  */
@@ -143,9 +166,25 @@ aIO_handle_t aIOOpenMessageQueue(char *name, long max_msg_num,
 aIO_handle_t aIOOpenUDPSocket(char *s_addr, in_port_t port, size_t buffer_size,
                               aIO_callback_t callback, void *args);
 
+/**
+ * @brief Sets the number of worker threads used to serve TCP clients
+ *
+ * The worker pool is started when the first TCP socket is opened, after
+ * which its size can no longer be changed.
+ *
+ * @param count Number of worker threads, must be greater than 0
+ * @return returns 0 on success; -1 if count is invalid or the pool has already
+ * been started.
+ */
+int aIOSetTCPWorkerCount(unsigned int count);
+
 /**
  * @brief Opens a socket enpoint
  *
+ * Accepted clients are handed to the TCP worker pool, see
+ * @ref AIO_TCP_WORKERS. The callback of a single client is always called from
+ * the same worker thread, callbacks of different clients may run concurrently.
+ *
  * @param s_addr IP address of target client in IPv4 numbers-and-dots notation.
  * eg. 127.0.0.1. NULL for localhost/loopback.
  * @param port Port to open the socket on
@@ -173,6 +173,40 @@ void vPortInitialiseBlocks(void) PRIVILEGED_FUNCTION;
 size_t xPortGetFreeHeapSize(void) PRIVILEGED_FUNCTION;
 size_t xPortGetMinimumEverFreeHeapSize(void) PRIVILEGED_FUNCTION;
 
+/*
+ * Statistics of the size-class pool heap in heap_pool.c.  Free sizes count
+ * the bytes of blocks carved from slabs but not in use, requests larger than
+ * the biggest size class are passed on to malloc() and counted separately.
+ */
+#define portHEAP_POOL_CLASSES 9
+
+typedef struct xHEAP_CLASS_STATS {
+    size_t xBlockSize;              /* Usable bytes per block. */
+    size_t xBlocks;                 /* Blocks carved from slabs. */
+    size_t xBlocksInUse;
+    size_t xMaxBlocksInUse;         /* High-water mark. */
+    size_t xRequestedBytesInUse;    /* Bytes asked for by the blocks in use. */
+    size_t xAllocations;
+    size_t xFrees;
+} HeapClassStats_t;
+
+typedef struct xHEAP_STATS {
+    HeapClassStats_t xClasses[portHEAP_POOL_CLASSES];
+    size_t xSlabs;
+    size_t xSlabBytes;
+    size_t xFreeBytes;              /* See xPortGetFreeHeapSize(). */
+    size_t xMinimumEverFreeBytes;
+    size_t xInternalFragmentation;  /* Block bytes in use but not requested. */
+    size_t xLargeAllocations;
+    size_t xLargeBytesInUse;
+    size_t xMaxLargeBytesInUse;
+    size_t xAllocations;
+    size_t xFrees;
+    size_t xFailedAllocations;
+} HeapStats_t;
+
+void vPortGetHeapStats(HeapStats_t *pxHeapStats) PRIVILEGED_FUNCTION;
+
 /*
  * Setup the hardware ready for the scheduler to take control.  This generally
  * sets up a tick interrupt and sets timers for the correct tick frequency.
@@ -69,6 +69,11 @@
 /* Scheduler includes. */
 #include "FreeRTOS.h"
 #include "task.h"
+
+#if (portUSE_FUTEX_SWITCH == 1)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 /*-----------------------------------------------------------*/
 
 #define MAX_NUMBER_OF_TASKS (_POSIX_THREAD_THREADS_MAX)
@@ -85,6 +90,9 @@ typedef struct THREAD_SUSPENSIONS {
     pthread_t hThread;
     xTaskHandle hTask;
     unsigned portBASE_TYPE uxCriticalNesting;
+#if (portUSE_FUTEX_SWITCH == 1)
+    volatile int iWake;
+#endif
 } xThreadState;
 /*-----------------------------------------------------------*/
 
@@ -103,6 +111,63 @@ static volatile portBASE_TYPE xServicingTick = pdFALSE;
 static volatile portBASE_TYPE xPendYield = pdFALSE;
 static volatile portLONG lIndexOfLastAddedTask = 0;
 static volatile unsigned portBASE_TYPE uxCriticalNesting;
+/* Origin of the run-time statistics counter. */
+static struct timespec xRunTimeStart = { 0 };
+/*-----------------------------------------------------------*/
+
+#define portNANOSECONDS_PER_SECOND 1000000000LL
+
+#if (portUSE_TICK_THREAD == 1)
+/* Ticks raised by the tick thread but not yet processed. */
+static volatile unsigned long ulPendingTicks = 0;
+/* Set by the idle task while it sleeps through the ticks. */
+static volatile portBASE_TYPE xTicksSuppressed = pdFALSE;
+static pthread_t hTickThread;
+
+/* Tick thread timing, all times in nanoseconds. */
+static struct {
+    unsigned long ulTicks;
+    unsigned long ulOverruns;
+    unsigned long ulCaughtUp;
+    long long llLateMin;
+    long long llLateMax;
+    long long llLateSum;
+} xTickStats;
+#endif
+
+#if (configUSE_TICKLESS_IDLE == 1)
+/* Longest single tickless sleep, keeps the statistics output alive. */
+#define portMAX_SUPPRESSED_TICKS (configTICK_RATE_HZ)
+
+#if (portUSE_TICK_THREAD == 1)
+/* Deadline of the tick raised last by the tick thread. */
+static long long llLastTickDeadline = 0;
+#else
+/* Time the tick handler ran last. */
+static long long llLastTickTime = 0;
+#endif
+
+/* Tickless idle residency and wake-up accuracy, times in nanoseconds. */
+static struct {
+    long long llStart;
+    long long llLastPrint;
+    long long llAsleep;
+    unsigned long ulSleeps;
+    unsigned long ulAborted;
+    unsigned long ulEarly;
+    long long llLateMax;
+    long long llLateSum;
+} xIdleStats;
+#endif
+
+#if (portUSE_VIRTUAL_TIME == 1)
+/* Virtual ticks against the wall clock, times in nanoseconds. */
+static struct {
+    unsigned long ulTicks;
+    unsigned long ulJumps;
+    long long llStart;
+} xVirtualTime;
+#endif
 /*-----------------------------------------------------------*/
 
 /*
@@ -121,6 +186,28 @@ static void prvSetTaskCriticalNesting(pthread_t xThreadId,
                                       unsigned portBASE_TYPE uxNesting);
 static unsigned portBASE_TYPE prvGetTaskCriticalNesting(pthread_t xThreadId);
 static void prvDeleteThread(void *xThreadId);
+#if (portUSE_TICK_THREAD == 1)
+static void *prvTickThread(void *pvParams);
+static void prvPrintTickStats(void);
+#endif
+#if (configUSE_TICKLESS_IDLE == 1) || (portUSE_VIRTUAL_TIME == 1)
+static long long prvGetMonotonicTime(void);
+#endif
+#if (portUSE_VIRTUAL_TIME == 1)
+static void prvCountVirtualTicks(TickType_t xTicks);
+#endif
+#if (configUSE_TICKLESS_IDLE == 1)
+static void prvStopTickInterrupt(void);
+static void prvStartTickInterrupt(void);
+static long long prvGetWakeTime(TickType_t xExpectedIdleTime, long long llNow);
+static void prvStepSleptTicks(TickType_t xExpectedIdleTime, long long llAwake);
+static void prvPrintIdleStats(long long llNow);
+#endif
+#if (portUSE_FUTEX_SWITCH == 1)
+static xThreadState *prvGetThreadState(pthread_t xThreadId);
+static void prvParkSelf(void);
+static void prvWakeThread(xThreadState *pxState);
+#endif
 /*-----------------------------------------------------------*/
 
 /*
@@ -260,6 +347,10 @@ void vPortEndScheduler(void)
             /* Kill all of the threads, they are in the detached state. */
             pthread_cancel(pxThreads[xNumberOfThreads].hThread);
             /** xResult = pthread_cancel( pxThreads[ xNumberOfThreads ].hThread ); */
+#if (portUSE_FUTEX_SWITCH == 1)
+            /* Parked threads only notice the cancellation once woken. */
+            prvWakeThread(&pxThreads[xNumberOfThreads]);
+#endif
         }
     }
 
@@ -367,6 +458,110 @@ void vPortClearInterruptMask(portBASE_TYPE xMask)
  * Setup the systick timer to generate the tick interrupts at the required
  * frequency.
  */
+#if (portUSE_VIRTUAL_TIME == 1)
+void prvSetupTimerInterrupt(void)
+{
+    /* There is no tick source, time only advances once all tasks are
+    blocked, see vPortAdvanceVirtualTime. */
+}
+/*-----------------------------------------------------------*/
+#elif (portUSE_TICK_THREAD == 1)
+void prvSetupTimerInterrupt(void)
+{
+    /* Interrupts are disabled here, so the tick thread is created with all
+    signals blocked and never runs any of the handlers itself. */
+    if (0 != pthread_create(&hTickThread, NULL, prvTickThread, NULL)) {
+        printf("Tick thread problem.\n");
+    }
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Raises the tick at absolute CLOCK_MONOTONIC deadlines, so the tick rate
+ * does not drift however late a single wake-up is. The tick is delivered
+ * as SIG_TICK to the thread of the running task, ticks that could not be
+ * processed in time are counted in ulPendingTicks and caught up by the
+ * next tick handler instead of being coalesced.
+ */
+void *prvTickThread(void *pvParams)
+{
+    struct timespec xDeadline, xNow;
+    long long llPeriod = portTICK_RATE_MICROSECONDS * 1000LL;
+    long long llLate;
+    unsigned long ulStatsTicks = 0;
+    pthread_t xRunning;
+
+    xTickStats.llLateMin = LLONG_MAX;
+
+    clock_gettime(CLOCK_MONOTONIC, &xDeadline);
+
+    while (pdTRUE != xSchedulerEnd) {
+        xDeadline.tv_nsec += llPeriod;
+        while (xDeadline.tv_nsec >= portNANOSECONDS_PER_SECOND) {
+            xDeadline.tv_nsec -= portNANOSECONDS_PER_SECOND;
+            xDeadline.tv_sec++;
+        }
+
+        while (EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+                                        &xDeadline, NULL))
+            ;
+
+        clock_gettime(CLOCK_MONOTONIC, &xNow);
+        llLate = (xNow.tv_sec - xDeadline.tv_sec) * portNANOSECONDS_PER_SECOND
+                 + xNow.tv_nsec - xDeadline.tv_nsec;
+
+        xTickStats.ulTicks++;
+        xTickStats.llLateSum += llLate;
+        if (llLate < xTickStats.llLateMin) {
+            xTickStats.llLateMin = llLate;
+        }
+        if (llLate > xTickStats.llLateMax) {
+            xTickStats.llLateMax = llLate;
+        }
+        if (llLate >= llPeriod) {
+            xTickStats.ulOverruns++;
+        }
+
+        __atomic_add_fetch(&ulPendingTicks, 1, __ATOMIC_RELEASE);
+#if (configUSE_TICKLESS_IDLE == 1)
+        __atomic_store_n(&llLastTickDeadline, xDeadline.tv_sec *
+                         portNANOSECONDS_PER_SECOND + xDeadline.tv_nsec,
+                         __ATOMIC_RELEASE);
+
+#endif
+
+        /* A sleeping idle task collects the ticks once it wakes up. */
+        xRunning = prvGetThreadHandle(xTaskGetCurrentTaskHandle());
+        if (((pthread_t)NULL != xRunning) && (pdTRUE != xTicksSuppressed)) {
+            (void)pthread_kill(xRunning, SIG_TICK);
+        }
+
+        if ((portTICK_STATS_PERIOD_S > 0) &&
+            (++ulStatsTicks == portTICK_STATS_PERIOD_S * configTICK_RATE_HZ)) {
+            prvPrintTickStats();
+            ulStatsTicks = 0;
+        }
+    }
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+void prvPrintTickStats(void)
+{
+    printf("Tick: %lu ticks, late min %lld max %lld mean %lld us, "
+           "%lu overruns, %lu ticks caught up\n",
+           xTickStats.ulTicks, xTickStats.llLateMin / 1000,
+           xTickStats.llLateMax / 1000,
+           xTickStats.llLateSum / (long long)xTickStats.ulTicks / 1000,
+           xTickStats.ulOverruns, xTickStats.ulCaughtUp);
+
+    /* Extremes are reported per period. */
+    xTickStats.llLateMin = LLONG_MAX;
+    xTickStats.llLateMax = 0;
+}
+/*-----------------------------------------------------------*/
+#else
 void prvSetupTimerInterrupt(void)
 {
     struct itimerval itimer, oitimer;
@@ -391,12 +586,293 @@ void prvSetupTimerInterrupt(void)
         printf("Get Timer problem.\n");
     }
 }
+#endif
 /*-----------------------------------------------------------*/
 
+#if (configUSE_TICKLESS_IDLE == 1) || (portUSE_VIRTUAL_TIME == 1)
+long long prvGetMonotonicTime(void)
+{
+    struct timespec xNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &xNow);
+    return xNow.tv_sec * portNANOSECONDS_PER_SECOND + xNow.tv_nsec;
+}
+/*-----------------------------------------------------------*/
+#endif
+
+#if (portUSE_VIRTUAL_TIME == 1)
+/*
+ * Called from the idle hook: nothing is left to run before the next tick,
+ * so raise it right away. The tick is pended while the scheduler is
+ * suspended and processed by xTaskResumeAll, which also switches to any
+ * task it unblocks.
+ */
+void vPortAdvanceVirtualTime(void)
+{
+    vTaskSuspendAll();
+    xTaskIncrementTick();
+    prvCountVirtualTicks(1);
+    (void)xTaskResumeAll();
+}
+/*-----------------------------------------------------------*/
+
+void prvCountVirtualTicks(TickType_t xTicks)
+{
+    unsigned long ulPeriod = portTICK_STATS_PERIOD_S * configTICK_RATE_HZ;
+    long long llWall;
+
+    if (0 == xVirtualTime.llStart) {
+        xVirtualTime.llStart = prvGetMonotonicTime();
+    }
+
+    xVirtualTime.ulJumps++;
+
+    if ((0 == ulPeriod) ||
+        ((xVirtualTime.ulTicks + xTicks) / ulPeriod ==
+         xVirtualTime.ulTicks / ulPeriod)) {
+        xVirtualTime.ulTicks += xTicks;
+        return;
+    }
+
+    xVirtualTime.ulTicks += xTicks;
+    llWall = prvGetMonotonicTime() - xVirtualTime.llStart;
+
+    printf("Virtual time: %lu ticks in %lu jumps, %.2f s wall clock, "
+           "x%.1f real time\n", xVirtualTime.ulTicks, xVirtualTime.ulJumps,
+           (double)llWall / portNANOSECONDS_PER_SECOND,
+           (double)xVirtualTime.ulTicks / configTICK_RATE_HZ *
+           portNANOSECONDS_PER_SECOND / llWall);
+}
+/*-----------------------------------------------------------*/
+#endif
+
+#if (configUSE_TICKLESS_IDLE == 1)
+
+void prvStopTickInterrupt(void)
+{
+#if (portUSE_TICK_THREAD == 1)
+    xTicksSuppressed = pdTRUE;
+#else
+    struct itimerval itimer = { { 0 } };
+
+    (void)setitimer(TIMER_TYPE, &itimer, NULL);
+#endif
+}
+/*-----------------------------------------------------------*/
+
+void prvStartTickInterrupt(void)
+{
+#if (portUSE_TICK_THREAD == 1)
+    xTicksSuppressed = pdFALSE;
+#else
+    prvSetupTimerInterrupt();
+#endif
+}
+/*-----------------------------------------------------------*/
+
+#if (portUSE_TICK_THREAD == 1)
+/*
+ * The tick thread keeps counting ticks while they are suppressed, so the
+ * tick count never drifts from its deadlines. Sleep until the deadline of
+ * the tick the next task unblocks at and collect the counted ticks.
+ */
+long long prvGetWakeTime(TickType_t xExpectedIdleTime, long long llNow)
+{
+    long long llPeriod = portTICK_RATE_MICROSECONDS * 1000LL;
+    unsigned long ulPending = __atomic_load_n(&ulPendingTicks,
+                                              __ATOMIC_ACQUIRE);
+    long long llDeadline = __atomic_load_n(&llLastTickDeadline,
+                                           __ATOMIC_ACQUIRE);
+
+    /* No tick raised yet or the ticks are due already. */
+    if ((0 == llDeadline) || (ulPending >= xExpectedIdleTime)) {
+        return llNow;
+    }
+
+    return llDeadline + (xExpectedIdleTime - ulPending) * llPeriod;
+}
+/*-----------------------------------------------------------*/
+
+void prvStepSleptTicks(TickType_t xExpectedIdleTime, long long llAwake)
+{
+    long long llPeriod = portTICK_RATE_MICROSECONDS * 1000LL;
+    long long llWakeTime = prvGetWakeTime(xExpectedIdleTime, llAwake);
+    unsigned long ulTicks;
+
+    /* Woke up on time, give the tick thread the chance to raise the tick
+    due at the same deadline, otherwise the idle task would spin until the
+    next tick is delivered. */
+    if (llAwake >= llWakeTime) {
+        while ((__atomic_load_n(&ulPendingTicks, __ATOMIC_ACQUIRE) <
+                xExpectedIdleTime) &&
+               (prvGetMonotonicTime() < llWakeTime + llPeriod)) {
+            sched_yield();
+        }
+    }
+
+    ulTicks = __atomic_exchange_n(&ulPendingTicks, 0, __ATOMIC_ACQUIRE);
+
+    if (ulTicks < xExpectedIdleTime) {
+        vTaskStepTick(ulTicks);
+        return;
+    }
+
+    /* Leave the last tick to the kernel, which unblocks the task. The
+    scheduler is suspended, so the remaining ticks are pended until it
+    resumes. */
+    vTaskStepTick(xExpectedIdleTime - 1);
+    ulTicks -= xExpectedIdleTime - 1;
+    while (ulTicks--) {
+        xTaskIncrementTick();
+    }
+}
+/*-----------------------------------------------------------*/
+#else
+/*
+ * The itimer is restarted after every sleep, so ticks are counted
+ * relative to the time the tick handler ran last.
+ */
+long long prvGetWakeTime(TickType_t xExpectedIdleTime, long long llNow)
+{
+    long long llPeriod = portTICK_RATE_MICROSECONDS * 1000LL;
+
+    /* Unless the last tick was not serviced in time. */
+    if (llLastTickTime < llNow - llPeriod) {
+        llLastTickTime = llNow - llPeriod;
+    }
+
+    return llLastTickTime + xExpectedIdleTime * llPeriod;
+}
+/*-----------------------------------------------------------*/
+
+void prvStepSleptTicks(TickType_t xExpectedIdleTime, long long llAwake)
+{
+    long long llPeriod = portTICK_RATE_MICROSECONDS * 1000LL;
+    TickType_t xTicks = (llAwake - llLastTickTime) / llPeriod;
+
+    llLastTickTime += xTicks * llPeriod;
+
+    if (xTicks < xExpectedIdleTime) {
+        vTaskStepTick(xTicks);
+        return;
+    }
+
+    /* Leave the last tick to the kernel, which unblocks the task. The
+    scheduler is suspended, so the remaining ticks are pended until it
+    resumes. */
+    vTaskStepTick(xExpectedIdleTime - 1);
+    xTicks -= xExpectedIdleTime - 1;
+    while (xTicks--) {
+        xTaskIncrementTick();
+    }
+}
+/*-----------------------------------------------------------*/
+#endif
+
+/*
+ * Called by the idle task with the scheduler suspended. Stops the tick,
+ * sleeps until the tick at which the next task unblocks and steps the tick
+ * count over the ticks slept through. Signals, e.g. SIGIO from AsyncIO,
+ * end the sleep early.
+ */
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime)
+{
+    long long llWakeTime, llNow, llAwake, llLate;
+    struct timespec xWake;
+
+    if (xExpectedIdleTime > portMAX_SUPPRESSED_TICKS) {
+        xExpectedIdleTime = portMAX_SUPPRESSED_TICKS;
+    }
+
+#if (portUSE_VIRTUAL_TIME == 1)
+    /* Nothing to sleep through, jump straight to the tick the next task
+    unblocks at. */
+    if (eAbortSleep == eTaskConfirmSleepModeStatus()) {
+        return;
+    }
+    vTaskStepTick(xExpectedIdleTime - 1);
+    xTaskIncrementTick();
+    prvCountVirtualTicks(xExpectedIdleTime);
+    return;
+#endif
+
+    vPortDisableInterrupts();
+    prvStopTickInterrupt();
+
+    llNow = prvGetMonotonicTime();
+    if (0 == xIdleStats.llStart) {
+        xIdleStats.llStart = llNow;
+        xIdleStats.llLastPrint = llNow;
+    }
+
+    /* A task may have been readied since the expected idle time was
+    calculated. */
+    if (eAbortSleep == eTaskConfirmSleepModeStatus()) {
+        xIdleStats.ulAborted++;
+        prvStartTickInterrupt();
+        vPortEnableInterrupts();
+        return;
+    }
+
+    llWakeTime = prvGetWakeTime(xExpectedIdleTime, llNow);
+    xWake.tv_sec = llWakeTime / portNANOSECONDS_PER_SECOND;
+    xWake.tv_nsec = llWakeTime % portNANOSECONDS_PER_SECOND;
+
+    (void)clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &xWake, NULL);
+
+    llAwake = prvGetMonotonicTime();
+    llLate = llAwake - llWakeTime;
+
+    prvStepSleptTicks(xExpectedIdleTime, llAwake);
+
+    prvStartTickInterrupt();
+    vPortEnableInterrupts();
+
+    xIdleStats.ulSleeps++;
+    xIdleStats.llAsleep += llAwake - llNow;
+    if (llLate < 0) {
+        /* Woken by a signal. */
+        xIdleStats.ulEarly++;
+    }
+    else {
+        xIdleStats.llLateSum += llLate;
+        if (llLate > xIdleStats.llLateMax) {
+            xIdleStats.llLateMax = llLate;
+        }
+    }
+
+    if ((portTICK_STATS_PERIOD_S > 0) &&
+        (llAwake - xIdleStats.llLastPrint >=
+         portTICK_STATS_PERIOD_S * portNANOSECONDS_PER_SECOND)) {
+        prvPrintIdleStats(llAwake);
+    }
+}
+/*-----------------------------------------------------------*/
+
+void prvPrintIdleStats(long long llNow)
+{
+    unsigned long ulOnTime = xIdleStats.ulSleeps - xIdleStats.ulEarly;
+
+    printf("Idle: %.1f%% tickless, %lu sleeps, %lu aborted, %lu woken early, "
+           "late max %lld mean %lld us\n",
+           100.0 * xIdleStats.llAsleep / (llNow - xIdleStats.llStart),
+           xIdleStats.ulSleeps, xIdleStats.ulAborted, xIdleStats.ulEarly,
+           xIdleStats.llLateMax / 1000,
+           ulOnTime ? xIdleStats.llLateSum / (long long)ulOnTime / 1000 : 0);
+
+    xIdleStats.llLastPrint = llNow;
+    xIdleStats.llLateMax = 0;
+}
+/*-----------------------------------------------------------*/
+#endif
+
 void vPortSystemTickHandler(int sig)
 {
     pthread_t xTaskToSuspend;
     pthread_t xTaskToResume;
+#if (portUSE_TICK_THREAD == 1)
+    unsigned long ulTicks;
+#endif
 
     if ((pdTRUE == xInterruptsEnabled) && (pdTRUE != xServicingTick)) {
         if (0 == pthread_mutex_trylock(&xSingleThreadMutex)) {
@@ -404,8 +880,23 @@ void vPortSystemTickHandler(int sig)
 
             xTaskToSuspend =
                 prvGetThreadHandle(xTaskGetCurrentTaskHandle());
+#if (configUSE_TICKLESS_IDLE == 1) && (portUSE_TICK_THREAD != 1)
+            llLastTickTime = prvGetMonotonicTime();
+#endif
+#if (portUSE_TICK_THREAD == 1)
+            /* Catch up on ticks that arrived while interrupts were masked. */
+            ulTicks = __atomic_exchange_n(&ulPendingTicks, 0,
+                                          __ATOMIC_ACQUIRE);
+            if (ulTicks > 1) {
+                xTickStats.ulCaughtUp += ulTicks - 1;
+            }
+            while (ulTicks--) {
+                xTaskIncrementTick();
+            }
+#else
             /* Tick Increment. */
             xTaskIncrementTick();
+#endif
 
             /* Select Next Task. */
 #if (configUSE_PREEMPTION == 1)
@@ -414,6 +905,12 @@ void vPortSystemTickHandler(int sig)
             xTaskToResume =
                 prvGetThreadHandle(xTaskGetCurrentTaskHandle());
 
+#if (portUSE_FUTEX_SWITCH == 1)
+            /* Parking below only returns once this task runs again, by
+            then the tick has long been serviced. The mutex is still held. */
+            xServicingTick = pdFALSE;
+#endif
+
             /* The only thread that can process this tick is the running thread. */
             if (xTaskToSuspend != xTaskToResume) {
                 /* Remember and switch the critical nesting. */
@@ -430,7 +927,9 @@ void vPortSystemTickHandler(int sig)
                 /* Release the lock as we are Resuming. */
                 (void)pthread_mutex_unlock(&xSingleThreadMutex);
             }
+#if (portUSE_FUTEX_SWITCH != 1)
             xServicingTick = pdFALSE;
+#endif
         }
         else {
             xPendYield = pdTRUE;
@@ -467,6 +966,9 @@ void vPortForciblyEndThread(void *pxTaskToDelete)
                 pthread_testcancel();
                 pthread_cancel(xTaskToDelete);
                 /** xResult = pthread_cancel( xTaskToDelete ); */
+#if (portUSE_FUTEX_SWITCH == 1)
+                prvWakeThread(prvGetThreadState(xTaskToDelete));
+#endif
                 /* Pthread Clean-up function will note the cancellation. */
             }
             (void)pthread_mutex_unlock(&xSingleThreadMutex);
@@ -508,6 +1010,11 @@ void *prvWaitForStart(void *pvParams)
 
 void prvSuspendSignalHandler(int sig)
 {
+#if (portUSE_FUTEX_SWITCH == 1)
+    /* Only used when a thread other than the running one services the
+    tick, the running thread parks itself directly otherwise. */
+    prvParkSelf();
+#else
     sigset_t xSignals;
 
     /* Only interested in the resume signal. */
@@ -533,12 +1040,22 @@ void prvSuspendSignalHandler(int sig)
     else {
         vPortDisableInterrupts();
     }
+#endif
 }
 /*-----------------------------------------------------------*/
 
 void prvSuspendThread(pthread_t xThreadId)
 {
-    portBASE_TYPE xResult = pthread_mutex_lock(&xSuspendResumeThreadMutex);
+    portBASE_TYPE xResult;
+
+#if (portUSE_FUTEX_SWITCH == 1)
+    if (pthread_self() == xThreadId) {
+        prvParkSelf();
+        return;
+    }
+#endif
+
+    xResult = pthread_mutex_lock(&xSuspendResumeThreadMutex);
     if (0 == xResult) {
         /* Set-up for the Suspend Signal handler? */
         xSentinel = 0;
@@ -562,6 +1079,12 @@ void prvResumeSignalHandler(int sig)
 
 void prvResumeThread(pthread_t xThreadId)
 {
+#if (portUSE_FUTEX_SWITCH == 1)
+    if (pthread_self() != xThreadId) {
+        prvWakeThread(prvGetThreadState(xThreadId));
+    }
+    return;
+#endif
     /** portBASE_TYPE xResult; */
     if (0 == pthread_mutex_lock(&xSuspendResumeThreadMutex)) {
         if (pthread_self() != xThreadId) {
@@ -595,6 +1118,9 @@ void prvSetupSignalsAndSchedulerPolicy(void)
         pxThreads[lIndex].hThread = (pthread_t)NULL;
         pxThreads[lIndex].hTask = (xTaskHandle)NULL;
         pxThreads[lIndex].uxCriticalNesting = 0;
+#if (portUSE_FUTEX_SWITCH == 1)
+        pxThreads[lIndex].iWake = 0;
+#endif
     }
 
     sigsuspendself.sa_flags = 0;
@@ -700,6 +1226,74 @@ void prvDeleteThread(void *xThreadId)
 }
 /*-----------------------------------------------------------*/
 
+#if (portUSE_FUTEX_SWITCH == 1)
+xThreadState *prvGetThreadState(pthread_t xThreadId)
+{
+    portLONG lIndex;
+    for (lIndex = 0; lIndex < MAX_NUMBER_OF_TASKS; lIndex++) {
+        if (pxThreads[lIndex].hThread == xThreadId) {
+            return &pxThreads[lIndex];
+        }
+    }
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Parks the calling thread until prvWakeThread is called for it. Must be
+ * called holding xSingleThreadMutex, which is released once the thread is
+ * about to sleep. All signals are blocked while parked so that the tick is
+ * only ever delivered to the running thread.
+ */
+void prvParkSelf(void)
+{
+    xThreadState *pxState = prvGetThreadState(pthread_self());
+    sigset_t xAllSignals, xPrevSignals;
+
+    sigfillset(&xAllSignals);
+    (void)pthread_sigmask(SIG_SETMASK, &xAllSignals, &xPrevSignals);
+
+    xSentinel = 1;
+
+    /* Unlock the Single thread mutex to allow the resumed task to continue. */
+    if (0 != pthread_mutex_unlock(&xSingleThreadMutex)) {
+        printf("Releasing someone else's lock.\n");
+    }
+
+    /* A wake issued before we got here is kept in the wake word. */
+    while (0 == __atomic_exchange_n(&pxState->iWake, 0, __ATOMIC_ACQUIRE)) {
+        (void)syscall(SYS_futex, &pxState->iWake, FUTEX_WAIT_PRIVATE, 0,
+                      NULL, NULL, 0);
+    }
+
+    /* Woken by vPortForciblyEndThread or vPortEndScheduler? */
+    pthread_testcancel();
+
+    (void)pthread_sigmask(SIG_SETMASK, &xPrevSignals, NULL);
+
+    /* Need to set the interrupts based on the task's critical nesting. */
+    if (uxCriticalNesting == 0) {
+        vPortEnableInterrupts();
+    }
+    else {
+        vPortDisableInterrupts();
+    }
+}
+/*-----------------------------------------------------------*/
+
+void prvWakeThread(xThreadState *pxState)
+{
+    if (NULL == pxState) {
+        return;
+    }
+
+    __atomic_store_n(&pxState->iWake, 1, __ATOMIC_RELEASE);
+    (void)syscall(SYS_futex, &pxState->iWake, FUTEX_WAKE_PRIVATE, 1,
+                  NULL, NULL, 0);
+}
+/*-----------------------------------------------------------*/
+#endif
+
 void vPortAddTaskHandle(void *pxTaskHandle)
 {
     portLONG lIndex;
@@ -721,24 +1315,29 @@ void vPortAddTaskHandle(void *pxTaskHandle)
 
 void vPortFindTicksPerSecond(void)
 {
-    /* Needs to be reasonably high for accuracy. */
-    unsigned long ulTicksPerSecond = sysconf(_SC_CLK_TCK);
-    printf("Timer Resolution for Run TimeStats is %ld ticks per second.\n",
-           ulTicksPerSecond);
+    struct timespec xNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &xNow);
+    xRunTimeStart = xNow;
+
+    printf("Timer Resolution for Run TimeStats is %d ticks per second.\n",
+           portRUN_TIME_TICKS_PER_SECOND);
 }
 /*-----------------------------------------------------------*/
 
 unsigned long ulPortGetTimerValue(void)
 {
-    struct tms xTimes;
-    unsigned long ulTotalTime = times(&xTimes);
-    /* Return the application code times.
-     * The timer only increases when the application code is actually running
-     * which means that the total execution times should add up to 100%.
-     */
-    return (unsigned long)xTimes.tms_utime;
+    struct timespec xNow;
 
-    /* Should check ulTotalTime for being clock_t max minus 1. */
-    (void)ulTotalTime;
+    /* Wall clock microseconds since the scheduler started. Unlike the
+     * process times(2) used before this also accounts time a task spends
+     * in system calls, and the resolution is fine enough to tell apart
+     * tasks that only run for a fraction of a tick. The kernel keeps the
+     * counters in 32 bits, so they wrap after about 71 minutes.
+     */
+    clock_gettime(CLOCK_MONOTONIC, &xNow);
+    return (unsigned long)(xNow.tv_sec - xRunTimeStart.tv_sec) *
+           portRUN_TIME_TICKS_PER_SECOND +
+           (xNow.tv_nsec - xRunTimeStart.tv_nsec) / 1000;
 }
 /*-----------------------------------------------------------*/
@@ -158,6 +158,36 @@ extern void vPortForciblyEndThread(void *pxTaskToDelete);
 extern void vPortAddTaskHandle(void *pxTaskHandle);
 #define traceTASK_CREATE( pxNewTCB )            vPortAddTaskHandle( pxNewTCB )
 
+/* Set to 1 to park and wake task threads with per-thread futexes instead
+of SIG_SUSPEND/SIG_RESUME on context switches (Linux only). */
+#ifndef portUSE_FUTEX_SWITCH
+#define portUSE_FUTEX_SWITCH        0
+#endif
+
+/* Set to 1 to raise the tick from a dedicated thread sleeping until absolute
+CLOCK_MONOTONIC deadlines instead of using setitimer. Tick timing statistics
+are printed every portTICK_STATS_PERIOD_S seconds, 0 disables them. */
+#ifndef portUSE_TICK_THREAD
+#define portUSE_TICK_THREAD         0
+#endif
+#ifndef portTICK_STATS_PERIOD_S
+#define portTICK_STATS_PERIOD_S     10
+#endif
+
+/* Set to 1 for virtual time: there is no tick source, instead the idle hook
+calls vPortAdvanceVirtualTime to jump to the next tick as soon as all tasks
+are blocked. Combined with configUSE_TICKLESS_IDLE the tick count jumps
+straight to the next task unblock time. */
+#ifndef portUSE_VIRTUAL_TIME
+#define portUSE_VIRTUAL_TIME        0
+#endif
+#if (portUSE_VIRTUAL_TIME == 1)
+#if (portUSE_TICK_THREAD == 1)
+#error "portUSE_VIRTUAL_TIME has no tick source, do not set portUSE_TICK_THREAD"
+#endif
+extern void vPortAdvanceVirtualTime(void);
+#endif
+
 /* Posix Signal definitions that can be changed or read as appropriate. */
 #define SIG_SUSPEND                 SIGUSR1
 #define SIG_RESUME                  SIGUSR2
@@ -172,7 +202,14 @@ extern void vPortAddTaskHandle(void *pxTaskHandle);
 #define SIG_TICK                    SIGPROF
 #define TIMER_TYPE                  ITIMER_PROF */
 
-/* Make use of times(man 2) to gather run-time statistics on the tasks. */
+/* Tickless idle, see configUSE_TICKLESS_IDLE. */
+#if (configUSE_TICKLESS_IDLE == 1)
+extern void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime);
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) vPortSuppressTicksAndSleep( xExpectedIdleTime )
+#endif
+
+/* Run-time statistics are gathered in CLOCK_MONOTONIC microseconds. */
+#define portRUN_TIME_TICKS_PER_SECOND               1000000
 extern void vPortFindTicksPerSecond(void);
 #define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()    vPortFindTicksPerSecond()       /* Nothing to do because the timer is already present. */
 extern unsigned long ulPortGetTimerValue(void);
@@ -0,0 +1,298 @@
+/*
+ * Size-class pool implementation of pvPortMalloc() and vPortFree() for the
+ * Posix simulator.
+ *
+ * Requests are rounded up to one of portHEAP_POOL_CLASSES power of two size
+ * classes.  Every class keeps a free list of blocks carved from slabs that
+ * are obtained from malloc() when the list runs empty.  Freed blocks go back
+ * onto the free list of their class, slabs are never returned to the system.
+ * Requests larger than the biggest class are passed on to malloc() directly.
+ *
+ * In contrast to heap_3.c the scheduler is not suspended, a short critical
+ * section protects the free lists instead.
+ *
+ * The statistics are available through xPortGetFreeHeapSize(),
+ * xPortGetMinimumEverFreeHeapSize() and vPortGetHeapStats().
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Defining MPU_WRAPPERS_INCLUDED_FROM_API_FILE prevents task.h from redefining
+all the API functions to use the MPU wrappers.  That should only be done when
+task.h is included from an application file. */
+#define MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#undef MPU_WRAPPERS_INCLUDED_FROM_API_FILE
+
+/* Smallest size class, each further class doubles in size. */
+#define heapMIN_BLOCK_SIZE ( ( size_t ) 16 )
+#define heapMAX_BLOCK_SIZE ( heapMIN_BLOCK_SIZE << ( portHEAP_POOL_CLASSES - 1 ) )
+
+/* Slabs hold at least heapMIN_SLAB_BLOCKS blocks. */
+#define heapSLAB_SIZE ( ( size_t ) 16 * 1024 )
+#define heapMIN_SLAB_BLOCKS ( ( size_t ) 4 )
+
+/* Marks blocks obtained from malloc() directly. */
+#define heapLARGE_CLASS ( ( uint32_t ) 0xffffffff )
+
+/* Precedes every block, keeps the payload aligned like malloc() does. */
+typedef struct BLOCK_HEADER {
+    struct BLOCK_HEADER *pxNextFree;
+    uint32_t ulClass;
+    uint32_t ulRequested;
+} __attribute__((aligned(16))) BlockHeader_t;
+
+/*-----------------------------------------------------------*/
+
+static BlockHeader_t *pxFreeLists[portHEAP_POOL_CLASSES] = { NULL };
+static HeapStats_t xStats = { 0 };
+static BaseType_t xInitialised = pdFALSE;
+
+/*-----------------------------------------------------------*/
+
+static size_t prvClassSize(uint32_t ulClass)
+{
+    return heapMIN_BLOCK_SIZE << ulClass;
+}
+/*-----------------------------------------------------------*/
+
+static uint32_t prvSizeToClass(size_t xWantedSize)
+{
+    uint32_t ulClass = 0;
+
+    while (prvClassSize(ulClass) < xWantedSize) {
+        ulClass++;
+    }
+
+    return ulClass;
+}
+/*-----------------------------------------------------------*/
+
+/*
+ * Carves a new slab into blocks of the given class. Called with the free
+ * lists locked, malloc() itself is thread safe.
+ */
+static BaseType_t prvAddSlab(uint32_t ulClass)
+{
+    size_t xUnit = sizeof(BlockHeader_t) + prvClassSize(ulClass);
+    size_t xBlocks = heapSLAB_SIZE / xUnit;
+    uint8_t *pucSlab;
+    BlockHeader_t *pxBlock;
+    size_t x;
+
+    if (xBlocks < heapMIN_SLAB_BLOCKS) {
+        xBlocks = heapMIN_SLAB_BLOCKS;
+    }
+
+    pucSlab = malloc(xBlocks * xUnit);
+    if (pucSlab == NULL) {
+        return pdFAIL;
+    }
+
+    for (x = 0; x < xBlocks; x++) {
+        pxBlock = (BlockHeader_t *)(pucSlab + x * xUnit);
+        pxBlock->ulClass = ulClass;
+        pxBlock->pxNextFree = pxFreeLists[ulClass];
+        pxFreeLists[ulClass] = pxBlock;
+    }
+
+    xStats.xSlabs++;
+    xStats.xSlabBytes += xBlocks * xUnit;
+    xStats.xClasses[ulClass].xBlocks += xBlocks;
+    xStats.xFreeBytes += xBlocks * prvClassSize(ulClass);
+
+    return pdPASS;
+}
+/*-----------------------------------------------------------*/
+
+static void *prvLargeMalloc(size_t xWantedSize)
+{
+    BlockHeader_t *pxBlock = malloc(sizeof(BlockHeader_t) + xWantedSize);
+
+    if (pxBlock == NULL) {
+        return NULL;
+    }
+
+    pxBlock->ulClass = heapLARGE_CLASS;
+    pxBlock->ulRequested = xWantedSize;
+
+    taskENTER_CRITICAL();
+    {
+        xStats.xAllocations++;
+        xStats.xLargeAllocations++;
+        xStats.xLargeBytesInUse += xWantedSize;
+        if (xStats.xLargeBytesInUse > xStats.xMaxLargeBytesInUse) {
+            xStats.xMaxLargeBytesInUse = xStats.xLargeBytesInUse;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return pxBlock + 1;
+}
+/*-----------------------------------------------------------*/
+
+void *pvPortMalloc(size_t xWantedSize)
+{
+    BlockHeader_t *pxBlock = NULL;
+    HeapClassStats_t *pxClass;
+    uint32_t ulClass;
+
+    if (xInitialised == pdFALSE) {
+        vPortInitialiseBlocks();
+    }
+
+    if (xWantedSize > heapMAX_BLOCK_SIZE) {
+        pxBlock = prvLargeMalloc(xWantedSize);
+        if (pxBlock != NULL) {
+            return pxBlock;
+        }
+        goto failed;
+    }
+
+    ulClass = prvSizeToClass(xWantedSize);
+    pxClass = &xStats.xClasses[ulClass];
+
+    taskENTER_CRITICAL();
+    {
+        if ((pxFreeLists[ulClass] != NULL) || (prvAddSlab(ulClass) == pdPASS)) {
+            pxBlock = pxFreeLists[ulClass];
+            pxFreeLists[ulClass] = pxBlock->pxNextFree;
+            pxBlock->ulRequested = xWantedSize;
+
+            pxClass->xAllocations++;
+            pxClass->xBlocksInUse++;
+            pxClass->xRequestedBytesInUse += xWantedSize;
+            if (pxClass->xBlocksInUse > pxClass->xMaxBlocksInUse) {
+                pxClass->xMaxBlocksInUse = pxClass->xBlocksInUse;
+            }
+
+            xStats.xAllocations++;
+            xStats.xFreeBytes -= pxClass->xBlockSize;
+            if (xStats.xFreeBytes < xStats.xMinimumEverFreeBytes) {
+                xStats.xMinimumEverFreeBytes = xStats.xFreeBytes;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if (pxBlock != NULL) {
+        return pxBlock + 1;
+    }
+
+failed:
+    taskENTER_CRITICAL();
+    {
+        xStats.xFailedAllocations++;
+    }
+    taskEXIT_CRITICAL();
+
+#if( configUSE_MALLOC_FAILED_HOOK == 1 )
+    {
+        extern void vApplicationMallocFailedHook(void);
+        vApplicationMallocFailedHook();
+    }
+#endif
+
+    return NULL;
+}
+/*-----------------------------------------------------------*/
+
+void vPortFree(void *pv)
+{
+    BlockHeader_t *pxBlock = (BlockHeader_t *)pv - 1;
+    HeapClassStats_t *pxClass;
+
+    if (pv == NULL) {
+        return;
+    }
+
+    if (pxBlock->ulClass == heapLARGE_CLASS) {
+        taskENTER_CRITICAL();
+        {
+            xStats.xFrees++;
+            xStats.xLargeBytesInUse -= pxBlock->ulRequested;
+        }
+        taskEXIT_CRITICAL();
+
+        free(pxBlock);
+        return;
+    }
+
+    configASSERT(pxBlock->ulClass < portHEAP_POOL_CLASSES);
+    pxClass = &xStats.xClasses[pxBlock->ulClass];
+
+    taskENTER_CRITICAL();
+    {
+        pxBlock->pxNextFree = pxFreeLists[pxBlock->ulClass];
+        pxFreeLists[pxBlock->ulClass] = pxBlock;
+
+        pxClass->xFrees++;
+        pxClass->xBlocksInUse--;
+        pxClass->xRequestedBytesInUse -= pxBlock->ulRequested;
+
+        xStats.xFrees++;
+        xStats.xFreeBytes += pxClass->xBlockSize;
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+void vPortInitialiseBlocks(void)
+{
+    uint32_t ulClass;
+
+    taskENTER_CRITICAL();
+    {
+        if (xInitialised == pdFALSE) {
+            for (ulClass = 0; ulClass < portHEAP_POOL_CLASSES; ulClass++) {
+                xStats.xClasses[ulClass].xBlockSize = prvClassSize(ulClass);
+            }
+            xStats.xMinimumEverFreeBytes = (size_t) -1;
+            xInitialised = pdTRUE;
+        }
+    }
+    taskEXIT_CRITICAL();
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetFreeHeapSize(void)
+{
+    return xStats.xFreeBytes;
+}
+/*-----------------------------------------------------------*/
+
+size_t xPortGetMinimumEverFreeHeapSize(void)
+{
+    /* Nothing allocated yet? */
+    if (xStats.xAllocations == xStats.xLargeAllocations) {
+        return xStats.xFreeBytes;
+    }
+
+    return xStats.xMinimumEverFreeBytes;
+}
+/*-----------------------------------------------------------*/
+
+void vPortGetHeapStats(HeapStats_t *pxHeapStats)
+{
+    HeapClassStats_t *pxClass;
+    uint32_t ulClass;
+
+    taskENTER_CRITICAL();
+    {
+        memcpy(pxHeapStats, &xStats, sizeof(HeapStats_t));
+    }
+    taskEXIT_CRITICAL();
+
+    pxHeapStats->xInternalFragmentation = 0;
+    for (ulClass = 0; ulClass < portHEAP_POOL_CLASSES; ulClass++) {
+        pxClass = &pxHeapStats->xClasses[ulClass];
+        pxHeapStats->xInternalFragmentation +=
+            pxClass->xBlocksInUse * pxClass->xBlockSize -
+            pxClass->xRequestedBytesInUse;
+    }
+}
+/*-----------------------------------------------------------*/
@@ -209,6 +209,7 @@ const int screen_width = SCREEN_WIDTH;
 SDL_Window *window = NULL;
 SDL_Renderer *renderer = NULL;
 SDL_GLContext context = NULL;
+static int vsync = 1;
 
 char *error_message = NULL;
 
@@ -665,43 +666,13 @@ static void logCriticalError(char *msg)
 	exit(-1);
 }
 
-#define NS_IN_SECOND 1000000000.0
-#define MS_IN_SECOND 1000.0
-#define NS_IN_MS 1000000.0
-
-static float timespecDiffMilli(struct timespec *start, struct timespec *stop)
-{
-	if ((stop->tv_nsec - start->tv_nsec) < 0)
-		return (stop->tv_sec - start->tv_sec - 1) * MS_IN_SECOND +
-		       (stop->tv_nsec - start->tv_nsec + NS_IN_SECOND) /
-			       NS_IN_MS;
-
-	return (stop->tv_sec - start->tv_sec) * MS_IN_SECOND +
-	       (stop->tv_nsec - start->tv_nsec) / NS_IN_MS;
-}
-
-#define FRAMELIMIT 60.0
-#define FRAMELIMIT_PERIOD 1000 / FRAMELIMIT
-
-int tumDrawUpdateScreen(void)
+int tumDrawRender(void)
 {
     if(tumUtilIsCurGLThread()){
         PRINT_ERROR("Updating screen from thread that does not hold GL context");
         goto err;
     }
 
-	static struct timespec last_time = { 0 }, cur_time = { 0 };
-
-	if (clock_gettime(CLOCK_MONOTONIC, &cur_time)) {
-		PRINT_ERROR("Failed to get monotonic clock");
-		goto err;
-	}
-
-	if (timespecDiffMilli(&last_time, &cur_time) < (float)FRAMELIMIT_PERIOD)
-		goto err;
-
-	memcpy(&last_time, &cur_time, sizeof(struct timespec));
-
 	if (job_list_head.next == NULL)
 		goto err;
 
@@ -716,8 +687,6 @@ int tumDrawUpdateScreen(void)
 		free(tmp_job);
 	}
 
-	SDL_RenderPresent(renderer);
-
 	return 0;
 
 draw_error:
@@ -726,6 +695,27 @@ err:
 	return -1;
 }
 
+int tumDrawPresent(void)
+{
+	if (tumUtilIsCurGLThread()) {
+		PRINT_ERROR("Presenting from thread that does not hold GL context");
+		return -1;
+	}
+
+	SDL_RenderPresent(renderer);
+
+	return 0;
+}
+
+int tumDrawUpdateScreen(void)
+{
+	// pacing is up to the caller, every queued frame is presented
+	if (tumDrawRender())
+		return -1;
+
+	return tumDrawPresent();
+}
+
 char *tumGetErrorMessage(void)
 {
 	return error_message;
@@ -811,6 +801,11 @@ err_sdl:
 	return -1;
 }
 
+void tumDrawSetVSync(int enable)
+{
+	vsync = enable;
+}
+
 int tumDrawBindThread(void) // Should be called from the Drawing Thread
 {
 	if (SDL_GL_MakeCurrent(window, context) < 0) {
@@ -826,7 +821,7 @@ int tumDrawBindThread(void) // Should be called from the Drawing Thread
 	renderer = SDL_CreateRenderer(window, -1,
 				      SDL_RENDERER_ACCELERATED |
 					      SDL_RENDERER_TARGETTEXTURE |
-					      SDL_RENDERER_PRESENTVSYNC);
+					      (vsync ? SDL_RENDERER_PRESENTVSYNC : 0));
 
 	if (renderer == NULL) {
 		PRINT_SDL_ERROR("Failed to create renderer");
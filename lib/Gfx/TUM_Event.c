@@ -43,7 +43,21 @@ typedef struct mouse {
 	signed short y;
 } mouse_t;
 
-QueueHandle_t buttonInputQueue = NULL;
+#define EVENT_RING_MASK (TUM_EVENT_RING_SIZE - 1)
+
+#define NS_IN_MS 1000000LL
+
+/**
+ * Events are pushed by the task fetching SDL events and popped by a single
+ * consumer. head is only written by the consumer, tail only by the
+ * producer, a slot is published by the release store of tail.
+ */
+static struct {
+	tum_event_t slots[TUM_EVENT_RING_SIZE];
+	unsigned int head;
+	unsigned int tail;
+	unsigned int dropped;
+} ring = { 0 };
 
 mouse_t mouse;
 
@@ -62,26 +76,57 @@ static int initMouse(void)
 	return 0;
 }
 
+static int64_t eventTime(Uint32 sdl_timestamp)
+{
+	Uint32 age_ms = SDL_GetTicks() - sdl_timestamp;
+
+	// SDL stamps events in ms since SDL_Init, when received from the OS
+	if (age_ms > SDL_GetTicks())
+		age_ms = 0;
+
+	return tumUtilTimeNs() - age_ms * NS_IN_MS;
+}
+
+static void pushEvent(int64_t time_ns, unsigned char type,
+		      unsigned short code)
+{
+	unsigned int tail = ring.tail;
+	tum_event_t *slot;
+
+	if (tail - __atomic_load_n(&ring.head, __ATOMIC_ACQUIRE) ==
+	    TUM_EVENT_RING_SIZE) {
+		__atomic_fetch_add(&ring.dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	slot = &ring.slots[tail & EVENT_RING_MASK];
+	slot->time_ns = time_ns;
+	slot->type = type;
+	slot->code = code;
+	slot->x = mouse.x;
+	slot->y = mouse.y;
+
+	__atomic_store_n(&ring.tail, tail + 1, __ATOMIC_RELEASE);
+}
+
 static void SDLFetchEvents(void)
 {
 	SDL_Event event = { 0 };
-	static unsigned char buttons[SDL_NUM_SCANCODES] = { 0 };
-	unsigned char send = 0;
 
 	while (SDL_PollEvent(&event)) {
 		if ((event.type == SDL_QUIT) ||
 		    (event.key.keysym.scancode == SDL_SCANCODE_Q)) {
 			exit(EXIT_SUCCESS);
 		} else if (event.type == SDL_KEYDOWN) {
-			xSemaphoreTake(mouse.lock, 0);
-			buttons[event.key.keysym.scancode] = 1;
-			xSemaphoreGive(mouse.lock);
-			send = 1;
+			if (event.key.repeat)
+				continue;
+			pushEvent(eventTime(event.common.timestamp),
+				  TUM_EVENT_KEY_DOWN,
+				  event.key.keysym.scancode);
 		} else if (event.type == SDL_KEYUP) {
-			xSemaphoreTake(mouse.lock, 0);
-			buttons[event.key.keysym.scancode] = 0;
-			xSemaphoreGive(mouse.lock);
-			send = 1;
+			pushEvent(eventTime(event.common.timestamp),
+				  TUM_EVENT_KEY_UP,
+				  event.key.keysym.scancode);
 		} else if (event.type == SDL_MOUSEMOTION) {
 			xSemaphoreTake(mouse.lock, 0);
 			mouse.x = event.motion.x;
@@ -102,8 +147,11 @@ static void SDLFetchEvents(void)
 			default:
 				break;
 			}
-			send = 1;
+			mouse.x = event.button.x;
+			mouse.y = event.button.y;
 			xSemaphoreGive(mouse.lock);
+			pushEvent(eventTime(event.common.timestamp),
+				  TUM_EVENT_MOUSE_DOWN, event.button.button);
 		} else if (event.type == SDL_MOUSEBUTTONUP) {
 			xSemaphoreTake(mouse.lock, 0);
 			switch (event.button.button) {
@@ -119,15 +167,37 @@ static void SDLFetchEvents(void)
 			default:
 				break;
 			}
-			send = 1;
+			mouse.x = event.button.x;
+			mouse.y = event.button.y;
 			xSemaphoreGive(mouse.lock);
+			pushEvent(eventTime(event.common.timestamp),
+				  TUM_EVENT_MOUSE_UP, event.button.button);
 		}
 	}
+}
 
-	if (send) {
-		xQueueOverwrite(buttonInputQueue, &buttons);
-		send = 0;
-	}
+void tumEventInject(unsigned char type, unsigned short code)
+{
+	pushEvent(tumUtilTimeNs(), type, code);
+}
+
+int tumEventPop(tum_event_t *event)
+{
+	unsigned int head = ring.head;
+
+	if (head == __atomic_load_n(&ring.tail, __ATOMIC_ACQUIRE))
+		return -1;
+
+	*event = ring.slots[head & EVENT_RING_MASK];
+
+	__atomic_store_n(&ring.head, head + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+unsigned int tumEventDropped(void)
+{
+	return __atomic_load_n(&ring.dropped, __ATOMIC_RELAXED);
 }
 
 #define FETCH_BLOCK_S 0
@@ -225,14 +295,6 @@ int tumEventInit(void)
 		goto err_init_mouse;
 	}
 
-	buttonInputQueue =
-		xQueueCreate(1, sizeof(unsigned char) * SDL_NUM_SCANCODES);
-
-	if (!buttonInputQueue) {
-		PRINT_ERROR("Creating mouse queue failed");
-		goto err_queue;
-	}
-
 	// Ignore SDL events
 	SDL_EventState(SDL_WINDOWEVENT, SDL_IGNORE);
 	SDL_EventState(SDL_TEXTINPUT, SDL_IGNORE);
@@ -240,14 +302,11 @@ int tumEventInit(void)
 
 	return 0;
 
-err_queue:
-	vSemaphoreDelete(mouse.lock);
 err_init_mouse:
 	return -1;
 }
 
 void tumEventExit(void)
 {
-	vQueueDelete(buttonInputQueue);
 	vSemaphoreDelete(mouse.lock);
 }
@@ -2,6 +2,9 @@
 
 #include <SDL2/SDL_mixer.h>
 
+#include "FreeRTOS.h"
+#include "queue.h"
+
 #include "TUM_Sound.h"
 #include "TUM_Utils.h"
 
@@ -12,6 +15,8 @@
 #define AUDIO_CHANNELS 2
 #define MIXING_CHANNELS 4
 
+#define SOUND_QUEUE_LENGTH 16
+
 #define GEN_FULL_SAMPLE_PATH(SAMPLE) SAMPLE_FOLDER #SAMPLE ".wav",
 
 char *waveFileNames[] = { FOR_EACH_SAMPLE(GEN_FULL_SAMPLE_PATH) };
@@ -20,6 +25,38 @@ char *fullWaveFileNames[NUM_WAVEFORMS] = { 0 };
 
 Mix_Chunk *samples[NUM_WAVEFORMS] = { 0 };
 
+/**
+ * Any task queues samples, only the sound task calls into SDL_mixer. It
+ * alone numbers the samples it starts and remembers the number on every
+ * channel, the counters are updated atomically.
+ */
+static struct {
+    QueueHandle_t queue;
+    unsigned long started[MIXING_CHANNELS]; /**< sample number */
+    unsigned long queued;
+    unsigned long dropped;
+    unsigned long played;
+    unsigned long stolen;
+} sound = { 0 };
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static StaticQueue_t sound_queue;
+static unsigned char sound_queue_storage[SOUND_QUEUE_LENGTH];
+#endif
+
+static int initQueue(void)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    sound.queue = xQueueCreateStatic(SOUND_QUEUE_LENGTH,
+                                     sizeof(unsigned char),
+                                     sound_queue_storage, &sound_queue);
+#else
+    sound.queue = xQueueCreate(SOUND_QUEUE_LENGTH, sizeof(unsigned char));
+#endif
+
+    return sound.queue ? 0 : -1;
+}
+
 void tumSoundExit(void)
 {
 #ifndef DOCKER
@@ -33,6 +70,11 @@ void tumSoundExit(void)
 
 int tumSoundInit(char *bin_dir_str)
 {
+    if (initQueue()) {
+        PRINT_ERROR("Failed to create sound queue");
+        return -1;
+    }
+
 #ifndef DOCKER
     int ret;
     size_t bin_dir_len = strlen(bin_dir_str);
@@ -93,7 +135,66 @@ err_file_names:
 
 void tumSoundPlaySample(unsigned char index)
 {
+    if (index >= NUM_WAVEFORMS || !sound.queue ||
+        xQueueSend(sound.queue, &index, 0) != pdTRUE) {
+        __atomic_fetch_add(&sound.dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    __atomic_fetch_add(&sound.queued, 1, __ATOMIC_RELAXED);
+}
+
+#ifndef DOCKER
+/**
+ * A free channel if there is one, otherwise the one playing the oldest
+ * sample, which is cut off
+ */
+static int stealChannel(void)
+{
+    int oldest = 0;
+    int i;
+
+    for (i = 0; i < MIXING_CHANNELS; i++) {
+        if (!Mix_Playing(i))
+            return i;
+        if (sound.started[i] < sound.started[oldest])
+            oldest = i;
+    }
+
+    Mix_HaltChannel(oldest);
+    __atomic_fetch_add(&sound.stolen, 1, __ATOMIC_RELAXED);
+
+    return oldest;
+}
+#endif /* DOCKER */
+
+void tumSoundTask(void *pvParameters)
+{
+    unsigned char index;
+    int channel;
+
+    while (1) {
+        if (xQueueReceive(sound.queue, &index, portMAX_DELAY) != pdTRUE)
+            continue;
+
 #ifndef DOCKER
-    Mix_PlayChannel(-1, samples[index], 0);
+        channel = stealChannel();
+        if (Mix_PlayChannel(channel, samples[index], 0) < 0) {
+            __atomic_fetch_add(&sound.dropped, 1, __ATOMIC_RELAXED);
+            continue;
+        }
+        sound.started[channel] = sound.played;
+#else
+        (void)channel;
 #endif /* DOCKER */
+        __atomic_fetch_add(&sound.played, 1, __ATOMIC_RELAXED);
+    }
+}
+
+void tumSoundGetStats(tum_sound_stats_t *stats)
+{
+    stats->queued = __atomic_load_n(&sound.queued, __ATOMIC_RELAXED);
+    stats->dropped = __atomic_load_n(&sound.dropped, __ATOMIC_RELAXED);
+    stats->played = __atomic_load_n(&sound.played, __ATOMIC_RELAXED);
+    stats->stolen = __atomic_load_n(&sound.stolen, __ATOMIC_RELAXED);
 }
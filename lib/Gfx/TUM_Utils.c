@@ -32,6 +32,11 @@
 #include <string.h>
 #include <libgen.h>
 #include <assert.h>
+#include <time.h>
+
+#include "TUM_Utils.h"
+
+#define NS_IN_S 1000000000ULL
 
 static pthread_mutex_t GL_thread_lock = PTHREAD_MUTEX_INITIALIZER;
 static pid_t cur_GL_thread = 0;
@@ -79,3 +84,13 @@ char *tumUtilGetBinFolderPath(char *bin_path)
 
 	return ret;
 }
+
+/** Also called by the function tracer's hooks, must not be traced itself */
+__attribute__((no_instrument_function)) uint64_t tumUtilTimeNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * NS_IN_S + ts.tv_nsec;
+}
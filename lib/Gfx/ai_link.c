@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+
+#include "ai_link.h"
+
+#define AI_MAILBOX_MASK (AI_MAILBOX_SIZE - 1)
+
+#define NS_IN_S 1000000000LL
+#define NS_IN_MS 1000000.0f
+
+// weight of the newest sample in the running averages
+#define AVG_WEIGHT 0.1f
+
+/**
+ * head is only written by the consumer, tail only by the producer.
+ * A slot is published by the release store of tail and handed back
+ * by the release store of head.
+ */
+static struct {
+    ai_command_t slots[AI_MAILBOX_SIZE];
+    unsigned int head;
+    unsigned int tail;
+    unsigned int dropped;
+} mailbox = { 0 };
+
+/**
+ * Receive statistics are only written by the producer, staleness only
+ * by the consumer and the send counters only by the sending task, so
+ * none of them needs a lock. Readers may see slightly torn snapshots.
+ */
+static struct {
+    ai_link_stats_t stats;
+
+    unsigned int peer_stamps;
+    unsigned int next_rx_seq;
+    unsigned int next_tx_seq;
+} link = { 0 };
+
+static int64_t xNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    return ts.tv_sec * NS_IN_S + ts.tv_nsec;
+}
+
+static void vAverage(float sample, float *last, float *avg, float *max)
+{
+    *last = sample;
+    *avg = (*avg == 0) ? sample : *avg + AVG_WEIGHT * (sample - *avg);
+    if (sample > *max) {
+        *max = sample;
+    }
+}
+
+static ai_cmd_e xParseCommand(const char *raw)
+{
+    if (!strcmp(raw, "INC")) {
+        return AI_CMD_INC;
+    }
+    if (!strcmp(raw, "DEC")) {
+        return AI_CMD_DEC;
+    }
+    return AI_CMD_UNKNOWN;
+}
+
+static void vParseStamps(ai_command_t *cmd, char *fields)
+{
+    int64_t echo_ns = 0, hold_ns = 0;
+    ai_link_stats_t *stats = &link.stats;
+
+    if (sscanf(fields, "%u %" SCNd64 " %" SCNd64 " %" SCNd64, &cmd->seq,
+               &cmd->sent_ns, &echo_ns, &hold_ns) < 2) {
+        return;
+    }
+
+    cmd->stamped = 1;
+    stats->stamped++;
+
+    if (!link.peer_stamps) {
+        link.next_rx_seq = cmd->seq;
+        __atomic_store_n(&link.peer_stamps, 1, __ATOMIC_RELAXED);
+    }
+
+    if (cmd->seq >= link.next_rx_seq) {
+        stats->lost += cmd->seq - link.next_rx_seq;
+        link.next_rx_seq = cmd->seq + 1;
+    }
+    else {
+        // late arrival of a command already counted as lost
+        stats->reordered++;
+        if (stats->lost) {
+            stats->lost--;
+        }
+    }
+
+    if (echo_ns) {
+        vAverage((cmd->received_ns - echo_ns - hold_ns) / NS_IN_MS,
+                 &stats->rtt_ms, &stats->rtt_avg_ms, &stats->rtt_max_ms);
+    }
+}
+
+int xAICommandPush(const char *buffer, size_t len)
+{
+    unsigned int tail = __atomic_load_n(&mailbox.tail, __ATOMIC_RELAXED);
+    unsigned int head = __atomic_load_n(&mailbox.head, __ATOMIC_ACQUIRE);
+    ai_command_t *slot;
+    char msg[AI_MSG_LEN];
+    char *fields;
+
+    if (tail - head == AI_MAILBOX_SIZE) {
+        __atomic_fetch_add(&mailbox.dropped, 1, __ATOMIC_RELAXED);
+        return -1;
+    }
+
+    slot = &mailbox.slots[tail & AI_MAILBOX_MASK];
+
+    if (len >= AI_MSG_LEN) {
+        len = AI_MSG_LEN - 1;
+    }
+    memcpy(msg, buffer, len);
+    msg[len] = '\0';
+
+    memset(slot, 0, sizeof(ai_command_t));
+    slot->received_ns = xNow();
+    link.stats.received++;
+
+    fields = strchr(msg, ' ');
+    if (fields) {
+        *fields++ = '\0';
+        vParseStamps(slot, fields);
+    }
+
+    strncpy(slot->raw, msg, AI_CMD_LEN - 1);
+    slot->cmd = xParseCommand(slot->raw);
+
+    __atomic_store_n(&mailbox.tail, tail + 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+int xAICommandPop(ai_command_t *cmd)
+{
+    unsigned int head = __atomic_load_n(&mailbox.head, __ATOMIC_RELAXED);
+    unsigned int tail = __atomic_load_n(&mailbox.tail, __ATOMIC_ACQUIRE);
+    ai_link_stats_t *stats = &link.stats;
+
+    if (head == tail) {
+        return -1;
+    }
+
+    memcpy(cmd, &mailbox.slots[head & AI_MAILBOX_MASK],
+           sizeof(ai_command_t));
+
+    __atomic_store_n(&mailbox.head, head + 1, __ATOMIC_RELEASE);
+
+    if (cmd->stamped) {
+        vAverage((xNow() - cmd->sent_ns) / NS_IN_MS, &stats->stale_ms,
+                 &stats->stale_avg_ms, &stats->stale_max_ms);
+    }
+
+    return 0;
+}
+
+unsigned int uxAICommandsDropped(void)
+{
+    return __atomic_load_n(&mailbox.dropped, __ATOMIC_RELAXED);
+}
+
+size_t xAILinkFormat(const char *token, char *msg)
+{
+    int len;
+
+    link.stats.sent++;
+
+    if (__atomic_load_n(&link.peer_stamps, __ATOMIC_RELAXED)) {
+        len = snprintf(msg, AI_MSG_LEN, "%s %u %" PRId64, token,
+                       link.next_tx_seq++, xNow());
+    }
+    else {
+        len = snprintf(msg, AI_MSG_LEN, "%s", token);
+    }
+
+    return (len < AI_MSG_LEN) ? len : AI_MSG_LEN - 1;
+}
+
+void vAILinkGetStats(ai_link_stats_t *stats)
+{
+    memcpy(stats, &link.stats, sizeof(ai_link_stats_t));
+    stats->dropped = uxAICommandsDropped();
+}
+
+void vAILinkDumpStats(FILE *fp)
+{
+    ai_link_stats_t stats;
+
+    vAILinkGetStats(&stats);
+
+    fprintf(fp, "[AI link] sent=%lu received=%lu stamped=%lu lost=%lu "
+            "reordered=%lu dropped=%lu rtt_ms=%.2f rtt_avg_ms=%.2f "
+            "rtt_max_ms=%.2f stale_ms=%.2f stale_avg_ms=%.2f "
+            "stale_max_ms=%.2f\n",
+            stats.sent, stats.received, stats.stamped, stats.lost,
+            stats.reordered, stats.dropped, stats.rtt_ms, stats.rtt_avg_ms,
+            stats.rtt_max_ms, stats.stale_ms, stats.stale_avg_ms,
+            stats.stale_max_ms);
+}
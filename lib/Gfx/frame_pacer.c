@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <SDL2/SDL.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "TUM_Draw.h"
+#include "TUM_Utils.h"
+#include "frame_pacer.h"
+
+#define DEFAULT_REFRESH_RATE 60
+
+#define NS_IN_S 1000000000ULL
+#define NS_IN_US 1000
+#define US_IN_MS 1000.0
+#define US_IN_S 1000000ULL
+
+static const char *mode_names[] = { "vsync", "cap", "uncapped" };
+
+/**
+ * Frame times are written by the presenting task only, readers copy the
+ * window in a critical section. Deadlines of the cap mode are kept in
+ * microseconds of tick time, so a rate that is no whole number of ticks
+ * still averages out.
+ */
+static struct {
+    int mode;
+    uint64_t period_us;
+    uint64_t next_us;
+    int pending;
+    uint64_t target_ns;
+    uint64_t last_present;
+    unsigned long frames;
+    unsigned long missed;
+    uint32_t times_us[FRAME_PACER_WINDOW];
+} pacer = { .mode = FRAME_PACE_VSYNC };
+
+int xFramePacerMode(const char *name)
+{
+    for (int i = 0; i < sizeof(mode_names) / sizeof(mode_names[0]); i++) {
+        if (!strcmp(name, mode_names[i])) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+int xFramePacerInit(int mode, unsigned int fps)
+{
+    SDL_DisplayMode display;
+
+    if (mode < FRAME_PACE_VSYNC || mode > FRAME_PACE_UNCAPPED ||
+        (mode == FRAME_PACE_CAP && !fps)) {
+        return -1;
+    }
+
+    if (mode == FRAME_PACE_VSYNC) {
+        fps = DEFAULT_REFRESH_RATE;
+        if (!SDL_GetCurrentDisplayMode(0, &display) &&
+            display.refresh_rate > 0) {
+            fps = display.refresh_rate;
+        }
+    }
+
+    pacer.mode = mode;
+    pacer.period_us = mode == FRAME_PACE_CAP ? US_IN_S / fps : 0;
+    pacer.target_ns = mode == FRAME_PACE_UNCAPPED ? 0 : NS_IN_S / fps;
+
+    tumDrawSetVSync(mode == FRAME_PACE_VSYNC);
+
+    return 0;
+}
+
+int xFramePacerWait(TickType_t max_wait)
+{
+    uint64_t now_us;
+    TickType_t now, due;
+
+    // with vsync presenting blocks, uncapped frames wait for nothing
+    if (pacer.mode != FRAME_PACE_CAP) {
+        return 0;
+    }
+
+    now = xTaskGetTickCount();
+    now_us = (uint64_t)now * US_IN_S / configTICK_RATE_HZ;
+
+    if (!pacer.pending) {
+        pacer.next_us += pacer.period_us;
+        if (pacer.next_us <= now_us) {
+            // late, start over from now instead of rushing to catch up
+            pacer.next_us = now_us;
+            return 0;
+        }
+        pacer.pending = 1;
+    }
+
+    due = pacer.next_us * configTICK_RATE_HZ / US_IN_S;
+    if (due > now) {
+        if (due - now > max_wait) {
+            vTaskDelay(max_wait);
+            return -1;
+        }
+        vTaskDelay(due - now);
+    }
+    pacer.pending = 0;
+
+    return 0;
+}
+
+void vFramePacerPresented(void)
+{
+    uint64_t now = tumUtilTimeNs();
+    uint64_t frame_time;
+
+    if (pacer.last_present) {
+        frame_time = now - pacer.last_present;
+
+        taskENTER_CRITICAL();
+        pacer.times_us[pacer.frames % FRAME_PACER_WINDOW] =
+            frame_time / NS_IN_US;
+        pacer.frames++;
+        if (pacer.target_ns && frame_time > pacer.target_ns * 3 / 2) {
+            pacer.missed++;
+        }
+        taskEXIT_CRITICAL();
+    }
+
+    pacer.last_present = now;
+}
+
+static int xCompareTimes(const void *a, const void *b)
+{
+    const uint32_t *x = a, *y = b;
+
+    return (*x > *y) - (*x < *y);
+}
+
+void vFramePacerGetStats(frame_pacer_stats_t *stats)
+{
+    uint32_t times[FRAME_PACER_WINDOW];
+    unsigned int count;
+
+    taskENTER_CRITICAL();
+    stats->frames = pacer.frames;
+    stats->missed = pacer.missed;
+    count = pacer.frames < FRAME_PACER_WINDOW ? pacer.frames :
+            FRAME_PACER_WINDOW;
+    memcpy(times, pacer.times_us, count * sizeof(uint32_t));
+    taskEXIT_CRITICAL();
+
+    stats->target_ms = pacer.target_ns / (float)(NS_IN_US * US_IN_MS);
+
+    if (!count) {
+        stats->p50_ms = stats->p95_ms = stats->p99_ms = stats->max_ms = 0;
+        return;
+    }
+
+    qsort(times, count, sizeof(uint32_t), xCompareTimes);
+
+    stats->p50_ms = times[count * 50 / 100] / US_IN_MS;
+    stats->p95_ms = times[count * 95 / 100] / US_IN_MS;
+    stats->p99_ms = times[count * 99 / 100] / US_IN_MS;
+    stats->max_ms = times[count - 1] / US_IN_MS;
+}
+
+void vFramePacerReport(FILE *fp)
+{
+    frame_pacer_stats_t stats;
+
+    vFramePacerGetStats(&stats);
+
+    if (stats.target_ms) {
+        fprintf(fp, "Frames (%s): %lu presented, %lu missed the %.1f ms "
+                "deadline\n", mode_names[pacer.mode], stats.frames,
+                stats.missed, stats.target_ms);
+    } else {
+        fprintf(fp, "Frames (%s): %lu presented\n", mode_names[pacer.mode],
+                stats.frames);
+    }
+    fprintf(fp, "Frame time of the last %u: p50 %.1f p95 %.1f p99 %.1f "
+            "max %.1f ms\n", stats.frames < FRAME_PACER_WINDOW ?
+            (unsigned int)stats.frames : FRAME_PACER_WINDOW, stats.p50_ms,
+            stats.p95_ms, stats.p99_ms, stats.max_ms);
+}
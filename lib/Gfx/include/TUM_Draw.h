@@ -133,6 +133,16 @@ int tumDrawInit(char *path);
  */
 int tumDrawBindThread(void);
 
+/**
+ * @brief Selects whether presenting waits for the display's vertical sync
+ *
+ * Takes effect when the renderer is created by tumDrawBindThread(). VSync
+ * is enabled by default.
+ *
+ * @param enable 1 to wait for vertical sync, 0 to present immediately
+ */
+void tumDrawSetVSync(int enable);
+
 /**
  * @brief Exits the TUM Draw backend
  *
@@ -161,6 +171,25 @@ void tumDrawExit(void);
  */
 int tumDrawUpdateScreen(void);
 
+/**
+ * @brief Executes the queued draw jobs without presenting them
+ *
+ * First half of tumDrawUpdateScreen(), e.g. to time rendering and
+ * presenting separately. Same restrictions as tumDrawUpdateScreen().
+ *
+ * @returns 0 on success, -1 if no jobs were queued or on errors
+ */
+int tumDrawRender(void);
+
+/**
+ * @brief Presents what has been rendered by tumDrawRender()
+ *
+ * Waits for the vertical sync if enabled, see tumDrawSetVSync().
+ *
+ * @returns 0 on success
+ */
+int tumDrawPresent(void);
+
 /**
  * @brief Sets the screen to a solid colour
  *
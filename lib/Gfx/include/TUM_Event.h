@@ -24,8 +24,9 @@
 #ifndef __TUM_EVENT_H__
 #define __TUM_EVENT_H__
 
+#include <stdint.h>
+
 #include "FreeRTOS.h"
-#include "queue.h"
 
 /**
  * @defgroup tum_event TUM Event API
@@ -34,18 +35,52 @@
  *
  * API to retrieve event's from the backend SDL library. Events are the movement
  * of the mouse and keypresses. Mouse coordinates are exposed through
- * @ref tumEventGetMouseX and @ref tumEventGetMouseY while keypress events are received by
- * retriving the most recent copy of the button status lookup table exposed
- * through the FreeRTOS queue @ref buttonInputQueue.
+ * @ref tumEventGetMouseX and @ref tumEventGetMouseY.
  *
- * @ref buttonInputQueue holds a single array of unsigned chars of the length
- * SDL_NUM_SCANCODES. The scancodes that are defind in the SDL header
- * SDL_scancode.h are used as the indicies when accessing the stored data in
- * the table.
+ * Key and mouse button presses and releases are delivered as timestamped
+ * @ref tum_event_t through a lock-free ring, see @ref tumEventPop, so
+ * presses between two frames are never lost. Keys are identified by the
+ * scancodes defined in the SDL header SDL_scancode.h.
  *
  * @{
  */
 
+/**
+ * @brief Number of events the ring can hold, must be a power of two
+ */
+#define TUM_EVENT_RING_SIZE 256
+
+/**
+ * @brief Types of @ref tum_event_t
+ */
+enum {
+	TUM_EVENT_KEY_DOWN = 0,
+	TUM_EVENT_KEY_UP,
+	TUM_EVENT_MOUSE_DOWN,
+	TUM_EVENT_MOUSE_UP,
+};
+
+/**
+ * @brief A key or mouse button press or release
+ *
+ * Key repeats generated while a key is held are not reported.
+ *
+ * @param time_ns CLOCK_MONOTONIC time SDL received the event
+ * @param type one of TUM_EVENT_KEY_DOWN, TUM_EVENT_KEY_UP,
+ * TUM_EVENT_MOUSE_DOWN and TUM_EVENT_MOUSE_UP
+ * @param code SDL scancode of a key event, SDL_BUTTON_LEFT,
+ * SDL_BUTTON_RIGHT or SDL_BUTTON_MIDDLE for a mouse event
+ * @param x Mouse X coord at the time of the event
+ * @param y Mouse Y coord at the time of the event
+ */
+typedef struct tum_event {
+	int64_t time_ns;
+	unsigned char type;
+	unsigned short code;
+	signed short x;
+	signed short y;
+} tum_event_t;
+
 /**
  * @brief Initializes the TUM Event backend
  *
@@ -93,6 +128,34 @@ signed char tumEventGetMouseRight(void);
  */
 signed char tumEventGetMouseMiddle(void);
 
+/**
+ * @brief Retrieves the oldest key or mouse button event
+ *
+ * Must only be called from a single task. Never blocks.
+ *
+ * @param event Filled with the popped event
+ * @return 0 on success, -1 if no event is pending
+ */
+int tumEventPop(tum_event_t *event);
+
+/**
+ * @brief Queues a synthetic key or mouse button event stamped with the
+ * current time, e.g. to drive the game without a keyboard
+ *
+ * Must only be called from the task fetching the events, see
+ * @ref tumEventFetchEvents.
+ *
+ * @param type one of TUM_EVENT_KEY_DOWN, TUM_EVENT_KEY_UP,
+ * TUM_EVENT_MOUSE_DOWN and TUM_EVENT_MOUSE_UP
+ * @param code SDL scancode or mouse button
+ */
+void tumEventInject(unsigned char type, unsigned short code);
+
+/**
+ * @brief Returns the number of events dropped because the ring was full
+ */
+unsigned int tumEventDropped(void);
+
 /**
  * @defgroup FETCH_EVENT_FLAGS Event fetching flags
  *
@@ -136,13 +199,5 @@ signed char tumEventGetMouseMiddle(void);
  */
 int tumEventFetchEvents(int flags);
 
-/*!<
- * @brief FreeRTOS queue used to obtain a current copy of the keyboard lookup table
- *
- * Sends an unsigned char array of length SDL_NUM_SCANCODES. Acts as a lookup
- * table using the SDL scancodes defined in <SDL2/SDL_scancode.h>
- */
-extern QueueHandle_t buttonInputQueue;
-
 /** @} */
 #endif
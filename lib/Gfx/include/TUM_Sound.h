@@ -74,8 +74,9 @@
 enum tumSound_samples_e { FOR_EACH_SAMPLE(GEN_ENUM) };
 
 /**
- * @brief Initializes the SDL2 Mixer library and loads the wav samples specified
- * in the @ref tumSound_samples_e
+ * @brief Initializes the SDL2 Mixer library, loads the wav samples specified
+ * in the @ref tumSound_samples_e and creates the queue served by
+ * @ref tumSoundTask
  *
  * @param bin_dir_str String specifying where the program's binary is located
  * @return 0 on success
@@ -88,14 +89,49 @@ int tumSoundInit(char *bin_dir_str);
 void tumSoundExit(void);
 
 /**
- * @brief Plays a wav sample
+ * @brief Queues a wav sample to be played by the sound task
+ *
+ * Never blocks, samples arriving while the queue is full are dropped. As
+ * long as @ref tumSoundTask runs at no higher priority than the caller,
+ * queueing does not switch to it either, so a game update is not
+ * interrupted by SDL_mixer.
  *
  * @param index Index to specify which sample to play, @ref tumSound_samples_e gives
  * appropriate indices
- * @return NULL always returns NULL
  */
 void tumSoundPlaySample(unsigned char index);
 
+/**
+ * @brief Task playing the queued samples, the only one calling into
+ * SDL_mixer once initialized
+ *
+ * Create it at the priority of the tasks queueing samples or below, it
+ * then plays them while these are blocked. The samples are decoded by
+ * @ref tumSoundInit. Every sample is started on
+ * a free mixing channel, if all channels are busy the sample playing the
+ * longest is cut off for the new one.
+ *
+ * @param pvParameters unused
+ */
+void tumSoundTask(void *pvParameters);
+
+/**
+ * @brief Sound counters since initialization
+ */
+typedef struct tum_sound_stats {
+    unsigned long queued; /**< Samples queued */
+    unsigned long dropped; /**< Samples not played, e.g. queue full */
+    unsigned long played; /**< Samples started */
+    unsigned long stolen; /**< Samples cut off for a newer one */
+} tum_sound_stats_t;
+
+/**
+ * @brief Returns the sound counters
+ *
+ * @param stats Filled with the counters
+ */
+void tumSoundGetStats(tum_sound_stats_t *stats);
+
 /** @}*/
 
 #endif
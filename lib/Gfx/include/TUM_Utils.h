@@ -24,6 +24,8 @@
 #ifndef __TUM_UTILS_H__
 #define __TUM_UTILS_H__
 
+#include <stdint.h>
+
 #define PRINT_ERROR(msg, ...) \
     fprintf(stderr, "[ERROR] " msg, ##__VA_ARGS__); \
     fprintf(stderr, "    @-> %s:%d, %s\n", __FILE__, __LINE__, __func__)
@@ -59,5 +61,13 @@ char *tumUtilPrependPath(char *path, char *file);
  */
 char *tumUtilGetBinFolderPath(char *bin_path);
 
+/**
+ * @brief CLOCK_MONOTONIC time in ns, the clock of all timing and profiling
+ * of the emulator
+ *
+ * @return Time in ns
+ */
+uint64_t tumUtilTimeNs(void);
+
 
 #endif
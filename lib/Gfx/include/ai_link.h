@@ -0,0 +1,146 @@
+#ifndef __AI_LINK_H__
+#define __AI_LINK_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @defgroup ai_link AI link API
+ *
+ * Transport of the mothership commands received from the AI
+ *
+ * Commands are pushed by the AsyncIO receive callback and popped by
+ * the play screen through a single-producer/single-consumer lock-free
+ * ring, so neither side ever blocks on the other.
+ *
+ * Messages may carry a sequence number and timestamps, appended as
+ * space separated fields to the plain protocol token:
+ *
+ * game -> AI: "<token> <seq> <sent_ns>"
+ * AI -> game: "<token> <seq> <sent_ns> <echo_ns> <hold_ns>"
+ *
+ * where echo_ns is the sent_ns of the latest game message seen by the
+ * AI and hold_ns the time the AI held it before deciding. Timestamps
+ * are CLOCK_REALTIME nanoseconds. The game only stamps its own messages
+ * once the AI has sent a stamped command, so AIs speaking the plain
+ * protocol keep working unchanged.
+ */
+
+/**
+ * Number of commands the mailbox can hold, must be a power of two
+ */
+#define AI_MAILBOX_SIZE 64
+/**
+ * Max. length of a single command token including terminator
+ */
+#define AI_CMD_LEN 30
+/**
+ * Max. length of a formatted outgoing message including terminator
+ */
+#define AI_MSG_LEN 80
+
+/**
+ * @brief parsed mothership command
+ */
+typedef enum {
+    AI_CMD_UNKNOWN = 0,
+    AI_CMD_INC,         // move right
+    AI_CMD_DEC,         // move left
+} ai_cmd_e;
+
+/**
+ * @brief command as received from the AI
+ *
+ * @param cmd parsed command
+ * @param raw command token as received, without stamps
+ * @param stamped command carried a sequence number and timestamps
+ * @param seq sequence number assigned by the AI
+ * @param sent_ns time the AI sent the command
+ * @param received_ns time the command was received
+ */
+typedef struct ai_command {
+    ai_cmd_e cmd;
+    char raw[AI_CMD_LEN];
+    unsigned int stamped;
+    unsigned int seq;
+    int64_t sent_ns;
+    int64_t received_ns;
+} ai_command_t;
+
+/**
+ * @brief link statistics
+ *
+ * @param sent messages sent to the AI
+ * @param received commands received from the AI
+ * @param stamped received commands carrying a sequence number
+ * @param lost gaps in the sequence numbers not filled by late commands
+ * @param reordered commands received after a newer one
+ * @param dropped commands dropped because the mailbox was full
+ * @param rtt_ms last round trip time, minus the AI's hold time
+ * @param stale_ms age of the last command when applied by the game
+ */
+typedef struct ai_link_stats {
+    unsigned long sent;
+    unsigned long received;
+    unsigned long stamped;
+    unsigned long lost;
+    unsigned long reordered;
+    unsigned long dropped;
+
+    float rtt_ms;
+    float rtt_avg_ms;
+    float rtt_max_ms;
+
+    float stale_ms;
+    float stale_avg_ms;
+    float stale_max_ms;
+} ai_link_stats_t;
+
+/**
+ * @brief parses and stores a received command
+ *
+ * Must only be called from a single producer, i.e. the AsyncIO
+ * receive callback. Never blocks.
+ *
+ * @param buffer received data
+ * @param len number of received bytes
+ * @return 0 on success, -1 when the mailbox is full and the command
+ * was dropped
+ */
+int xAICommandPush(const char *buffer, size_t len);
+/**
+ * @brief retrieves the oldest pending command
+ *
+ * Must only be called from a single consumer, i.e. the play screen.
+ * Never blocks.
+ *
+ * @param cmd filled with the popped command
+ * @return 0 on success, -1 when no command is pending
+ */
+int xAICommandPop(ai_command_t *cmd);
+/**
+ * @brief number of commands dropped because the mailbox was full
+ */
+unsigned int uxAICommandsDropped(void);
+/**
+ * @brief formats a message to be sent to the AI
+ *
+ * Appends sequence number and timestamp once the AI is known to
+ * understand stamped messages.
+ *
+ * @param token plain protocol token, e.g. "PAUSE"
+ * @param msg buffer of at least AI_MSG_LEN bytes
+ * @return length of the formatted message
+ */
+size_t xAILinkFormat(const char *token, char *msg);
+/**
+ * @brief returns a snapshot of the link statistics
+ */
+void vAILinkGetStats(ai_link_stats_t *stats);
+/**
+ * @brief prints the link statistics as a single key=value line
+ */
+void vAILinkDumpStats(FILE *fp);
+
+#endif
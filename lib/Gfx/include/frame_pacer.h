@@ -0,0 +1,96 @@
+#ifndef __FRAME_PACER_H__
+#define __FRAME_PACER_H__
+
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+
+/**
+ * @defgroup frame_pacer Frame pacer API
+ *
+ * Decides when the task presenting the frames presents the next one
+ *
+ * - FRAME_PACE_VSYNC: presenting waits for the display's vertical sync,
+ *   the target frame time is the display's refresh period
+ * - FRAME_PACE_CAP: vsync off, frames are presented at a fixed rate
+ * - FRAME_PACE_UNCAPPED: vsync off, every frame is presented as soon as
+ *   it is drawn, for benchmarks
+ *
+ * The presenting task calls xFramePacerWait() until the next frame is due
+ * before it waits for that frame to be drawn and vFramePacerPresented()
+ * once it has been presented. The
+ * time between two presents is the frame time, a frame taking longer
+ * than 1.5 target frame times missed its deadline. Frame time percentiles
+ * are taken over the last FRAME_PACER_WINDOW frames.
+ */
+
+/**
+ * Number of recent frame times kept for the percentiles
+ */
+#define FRAME_PACER_WINDOW 1024
+
+enum {
+    FRAME_PACE_VSYNC = 0,
+    FRAME_PACE_CAP,
+    FRAME_PACE_UNCAPPED,
+};
+
+/**
+ * @brief frame statistics
+ *
+ * @param frames frames presented
+ * @param missed frames that missed their deadline
+ * @param target_ms target frame time, 0 when uncapped
+ * @param p50_ms median frame time of the window
+ * @param p95_ms 95th percentile
+ * @param p99_ms 99th percentile
+ * @param max_ms longest frame time of the window
+ */
+typedef struct frame_pacer_stats {
+    unsigned long frames;
+    unsigned long missed;
+    float target_ms;
+    float p50_ms;
+    float p95_ms;
+    float p99_ms;
+    float max_ms;
+} frame_pacer_stats_t;
+
+/**
+ * @brief parses a mode name
+ *
+ * @param name "vsync", "cap" or "uncapped"
+ * @return the mode, -1 for unknown names
+ */
+int xFramePacerMode(const char *name);
+/**
+ * @brief sets the pacing mode, must be called after tumDrawInit() and
+ * before the presenting task binds the drawing thread
+ *
+ * @param mode FRAME_PACE_VSYNC, FRAME_PACE_CAP or FRAME_PACE_UNCAPPED
+ * @param fps frame rate of FRAME_PACE_CAP
+ * @return 0 on success, -1 for invalid arguments
+ */
+int xFramePacerInit(int mode, unsigned int fps);
+/**
+ * @brief waits until the next frame is due, at most max_wait ticks, so
+ * the caller can do other work while waiting
+ *
+ * @param max_wait longest time to block in ticks
+ * @return 0 once the frame is due, -1 if it is not yet due
+ */
+int xFramePacerWait(TickType_t max_wait);
+/**
+ * @brief records that a frame has been presented
+ */
+void vFramePacerPresented(void);
+/**
+ * @brief returns the frame statistics
+ */
+void vFramePacerGetStats(frame_pacer_stats_t *stats);
+/**
+ * @brief prints the frame statistics
+ */
+void vFramePacerReport(FILE *fp);
+
+#endif
@@ -117,16 +117,25 @@ void vInit_playscreen(unsigned int inf_lives,
                       unsigned int score, unsigned int level,
                       unsigned int multiplayer);
 /** 
- * @brief draws playscreen with all its objects
+ * @brief advances the game by one frame: creates shots, checks
+ * collisions and updates positions
  * 
  * @param Flags Signals from main task
  * Flag 0: move left; Flag 1: move right
  * Flag 2: shoot; Flag 3: periodically create lasershot
+ * Flag 4: toggle difficulty
  * 
  * @param ms indicates time gone since last Wake time
  * -> update positions
+ * @return 0 while playing, 1 on game over, 2 once all aliens are gone
+ */
+int vUpdate_playscreen(unsigned int Flags[5], unsigned int ms);
+/**
+ * @brief draws playscreen with all its objects
+ *
+ * @param state return value of the frame's vUpdate_playscreen()
  */
-int vDraw_playscreen(unsigned int Flags[5], unsigned int ms);
+void vDraw_playscreen(int state);
 /**
  * 
  */
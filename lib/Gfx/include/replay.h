@@ -0,0 +1,108 @@
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+#include "TUM_Event.h"
+#include "ai_link.h"
+
+/**
+ * @defgroup replay Input recording and replay API
+ *
+ * Records everything a game session depends on, so it can be replayed
+ * identically, e.g. to benchmark the play loop before and after a change
+ *
+ * A recording holds the seed passed to srand() and, for every frame, the
+ * frame time in ticks since the first frame, the key and mouse events and
+ * the AI commands the frame consumed. The frame task reads them back in
+ * place of the live input.
+ *
+ * Both modes fold a few values of the game state into a digest after
+ * every frame. The digest is stored at the end of the recording and
+ * compared when the replay ends, so a diverging replay is reported.
+ *
+ * File format, all numbers little endian:
+ *
+ * @verbatim
+ header  "SIRP" version:u8 seed:u32
+ frame   'F' dt:var events:u8 commands:u8
+         events * (type:u8 code:var x:s16 y:s16)
+         commands * (len:u8 token:len)
+ end     'E' frames:u32 digest:u32
+ @endverbatim
+ *
+ * where var is an unsigned LEB128 number and dt the ticks since the
+ * previous frame.
+ */
+
+#define REPLAY_MAX_EVENTS 32
+#define REPLAY_MAX_COMMANDS AI_MAILBOX_SIZE
+
+enum {
+    REPLAY_OFF = 0,
+    REPLAY_RECORD,
+    REPLAY_PLAY,
+};
+
+/**
+ * @brief Input of a single frame
+ *
+ * @param tick frame time, ticks since the first frame
+ * @param events key and mouse events, time_ns is not recorded
+ * @param commands raw AI command tokens
+ */
+typedef struct replay_frame {
+    TickType_t tick;
+    tum_event_t events[REPLAY_MAX_EVENTS];
+    unsigned int event_count;
+    char commands[REPLAY_MAX_COMMANDS][AI_CMD_LEN];
+    unsigned int command_count;
+} replay_frame_t;
+
+/**
+ * @brief Starts recording to a file
+ *
+ * @param path file to create
+ * @param seed seed the game passes to srand()
+ * @return 0 on success, -1 otherwise
+ */
+int xReplayRecord(const char *path, unsigned int seed);
+/**
+ * @brief Starts replaying a file
+ *
+ * @param path recorded file
+ * @param seed filled with the recorded seed
+ * @return 0 on success, -1 otherwise
+ */
+int xReplayPlay(const char *path, unsigned int *seed);
+/**
+ * @brief REPLAY_OFF, REPLAY_RECORD or REPLAY_PLAY
+ */
+int xReplayMode(void);
+/**
+ * @brief Appends a frame to the recording
+ *
+ * @return 0 on success, -1 otherwise
+ */
+int xReplayWriteFrame(const replay_frame_t *frame);
+/**
+ * @brief Reads the next frame of the replay
+ *
+ * @return 0 on success, -1 at the end of the recording or on errors
+ */
+int xReplayReadFrame(replay_frame_t *frame);
+/**
+ * @brief Folds a value of the game state into the digest
+ */
+void vReplayDigest(uint32_t value);
+/**
+ * @brief Ends recording or replay
+ *
+ * A recording is completed with frame count and digest, a replay prints
+ * frames, wall time and whether the digest matches the recording.
+ */
+void vReplayClose(void);
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef __SCREEN_MANAGER_H__
+#define __SCREEN_MANAGER_H__
+
+#include "FreeRTOS.h"
+
+/**
+ * @defgroup screen_manager Screen manager API
+ *
+ * Runs the game's screens cooperatively from a single frame task
+ *
+ * Every screen is a set of callbacks. Once per frame the frame task calls
+ * vScreenUpdate(), which runs the update callback of the current screen,
+ * followed by vScreenDraw() with the screen locked. A screen change
+ * requested through xScreenRequest() is applied right after the update,
+ * by calling the exit callback of the old and the enter callback of the
+ * new screen, so the new screen already draws the same frame. Timed
+ * screens, e.g. a banner shown for a few seconds, schedule their
+ * successor with xScreenRequestAfter() and keep drawing meanwhile.
+ *
+ * All functions must only be called from the frame task, i.e. from
+ * within the callbacks or between frames.
+ */
+
+/**
+ * Max. number of screens, screen ids range from 0 to SCREEN_MAX - 1
+ */
+#define SCREEN_MAX 8
+/**
+ * Screen id passed to enter before the first screen
+ */
+#define SCREEN_NONE -1
+
+/**
+ * @brief callbacks of a screen, any of them may be NULL
+ *
+ * @param name screen name, for debugging
+ * @param enter called when the screen becomes current, with the id of
+ * the previous screen
+ * @param update handles input and advances the screen's state
+ * @param draw draws the screen, called with the screen locked
+ * @param exit called when another screen is entered, with its id
+ */
+typedef struct screen {
+    const char *name;
+    void (*enter)(int from);
+    void (*update)(void);
+    void (*draw)(void);
+    void (*exit)(int to);
+} screen_t;
+
+/**
+ * @brief transition statistics
+ *
+ * @param transitions screen changes applied
+ * @param ignored requests ignored during the hold-off after a change
+ * @param last_us time from the last request until the new screen had
+ * drawn its first frame
+ * @param max_us longest such time
+ * @param total_us sum of all such times
+ */
+typedef struct screen_stats {
+    unsigned long transitions;
+    unsigned long ignored;
+    unsigned long last_us;
+    unsigned long max_us;
+    unsigned long long total_us;
+} screen_stats_t;
+
+/**
+ * @brief sets the clock of hold-off and timed requests, e.g. the start
+ * time of the current frame, the tick count by default
+ *
+ * @param now returns the current time in ticks, NULL for the tick count
+ */
+void vScreenSetClock(TickType_t (*now)(void));
+/**
+ * @brief registers a screen
+ *
+ * @param id screen id, 0 to SCREEN_MAX - 1
+ * @param screen callbacks, must stay valid
+ * @return 0 on success, -1 if the id is invalid
+ */
+int xScreenRegister(int id, const screen_t *screen);
+/**
+ * @brief enters the first screen
+ *
+ * @param id registered screen id
+ * @param holdoff ticks after a change during which further requests
+ * are ignored
+ * @return 0 on success, -1 if the screen is not registered
+ */
+int xScreenStart(int id, TickType_t holdoff);
+/**
+ * @brief requests a change to the given screen, applied after the
+ * current update
+ *
+ * Requesting the current screen exits and enters it again. A request is
+ * ignored while another one is pending and during the hold-off.
+ *
+ * @param id registered screen id
+ * @return 0 if the request was accepted, -1 otherwise
+ */
+int xScreenRequest(int id);
+/**
+ * @brief requests a change to the given screen once delay ticks have
+ * passed
+ *
+ * The change is applied before the first update after the delay, without
+ * hold-off. It is cancelled by any other change of the screen.
+ *
+ * @param id registered screen id
+ * @param delay ticks from now
+ * @return 0 on success, -1 if the screen is not registered
+ */
+int xScreenRequestAfter(int id, TickType_t delay);
+/**
+ * @brief id of the current screen
+ */
+int xScreenCurrent(void);
+/**
+ * @brief runs the update of the current screen and applies a requested
+ * change
+ */
+void vScreenUpdate(void);
+/**
+ * @brief draws the current screen
+ */
+void vScreenDraw(void);
+/**
+ * @brief returns a snapshot of the transition statistics
+ */
+void vScreenGetStats(screen_stats_t *stats);
+
+#endif
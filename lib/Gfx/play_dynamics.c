@@ -23,6 +23,9 @@
 #include "play_graphics.h"
 #include "menu_graphics.h"
 
+#include "lock_prof.h"
+#include "prof_zone.h"
+
 #define CENTER_X SCREEN_WIDTH / 2
 #define CENTER_Y SCREEN_HEIGHT / 2
 
@@ -40,6 +43,11 @@
 
 #define DY_PROJECTILE 200   // y-velocity of projectile and laser
 
+// samples queued to the sound task, see TUM_Sound.h
+#define SOUND_SHOT c5
+#define SOUND_ALIEN_HIT c3
+#define SOUND_MOTHERSHIP_HIT g3
+
 Object player = { 0 };
 
 Object mothership = { 0 };
@@ -60,6 +68,34 @@ Data gamedata = { 0 };
 
 Object explosion = { 0 };
 
+// gamedata, aliens, alien_velo, walls, player, mothership, projectile,
+// laser, explosion and bunkers
+#define PLAY_LOCKS (1 + 5 * 10 + 1 + 2 + 1 + 1 + 1 + 1 + 1 + 4)
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+static StaticSemaphore_t play_locks[PLAY_LOCKS];
+static unsigned int play_lock_count = 0;
+#endif
+
+/**
+ * The object mutexes are created by the first vInit_playscreen() and
+ * reused by every following level
+ */
+static SemaphoreHandle_t xPlayLock(SemaphoreHandle_t lock)
+{
+    if (lock) {
+        return lock;
+    }
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    if (play_lock_count == PLAY_LOCKS) {
+        return NULL;
+    }
+    return xSemaphoreCreateMutexStatic(&play_locks[play_lock_count++]);
+#else
+    return xSemaphoreCreateMutex();
+#endif
+}
 
 void vInit_playscreen(unsigned int inf_lives,
                       unsigned int score, unsigned int level,
@@ -91,12 +127,12 @@ void vInit_playscreen(unsigned int inf_lives,
         gamedata.multiplayer = 0;
     }
     gamedata.level = level;
-    gamedata.lock = xSemaphoreCreateMutex();
+    gamedata.lock = xPlayLock(gamedata.lock);
 
     // initialize aliens
     for (int row=0; row < 5; row++) {
         for (int col=0; col < 10; col++) {
-            aliens[row][col].lock = xSemaphoreCreateMutex();
+            aliens[row][col].lock = xPlayLock(aliens[row][col].lock);
             if (xSemaphoreTake(aliens[row][col].lock, portMAX_DELAY)) {
                 
 
@@ -125,7 +161,7 @@ void vInit_playscreen(unsigned int inf_lives,
     }
     
     // initialize alien velocities
-    alien_velo.lock = xSemaphoreCreateMutex();
+    alien_velo.lock = xPlayLock(alien_velo.lock);
     if (xSemaphoreTake(alien_velo.lock, portMAX_DELAY)) {
         alien_velo.dx = DX_ALIEN + level*10;
         alien_velo.dy = DY_ALIEN;
@@ -136,7 +172,7 @@ void vInit_playscreen(unsigned int inf_lives,
     }
 
     // initialize upper wall
-    upper_wall.lock = xSemaphoreCreateMutex();
+    upper_wall.lock = xPlayLock(upper_wall.lock);
     if (xSemaphoreTake(upper_wall.lock, portMAX_DELAY)) {
 
         upper_wall.x_coord = 100;
@@ -153,7 +189,7 @@ void vInit_playscreen(unsigned int inf_lives,
     }
 
     // initialize lower wall
-    lower_wall.lock = xSemaphoreCreateMutex();
+    lower_wall.lock = xPlayLock(lower_wall.lock);
     if (xSemaphoreTake(lower_wall.lock, portMAX_DELAY)) {
 
         lower_wall.x_coord = 100;
@@ -170,7 +206,7 @@ void vInit_playscreen(unsigned int inf_lives,
     }
 
     // initialize player
-    player.lock = xSemaphoreCreateMutex();
+    player.lock = xPlayLock(player.lock);
     if (xSemaphoreTake(player.lock, portMAX_DELAY)) {
 
         player.x_coord = CENTER_X - 6*px;
@@ -186,7 +222,7 @@ void vInit_playscreen(unsigned int inf_lives,
 
     // initialize mothership
     if (gamedata.multiplayer) {
-        mothership.lock = xSemaphoreCreateMutex();
+        mothership.lock = xPlayLock(mothership.lock);
         if (xSemaphoreTake(mothership.lock, portMAX_DELAY)) {
 
             mothership.x_coord = CENTER_X - 6*px;
@@ -197,11 +233,11 @@ void vInit_playscreen(unsigned int inf_lives,
 
             mothership.state = 1;
 
-            xSemaphoreGive(player.lock);
+            xSemaphoreGive(mothership.lock);
         }
     }
     else {
-        mothership.lock = xSemaphoreCreateMutex();
+        mothership.lock = xPlayLock(mothership.lock);
         if (xSemaphoreTake(mothership.lock, portMAX_DELAY)) {
 
             mothership.x_coord = 0;
@@ -212,12 +248,12 @@ void vInit_playscreen(unsigned int inf_lives,
 
             mothership.state = 0;
 
-            xSemaphoreGive(player.lock);
+            xSemaphoreGive(mothership.lock);
         }
     }
 
     // initialize projectile
-    projectile.lock = xSemaphoreCreateMutex();
+    projectile.lock = xPlayLock(projectile.lock);
     if (xSemaphoreTake(projectile.lock, portMAX_DELAY)) {
 
         projectile.x_coord = 0;
@@ -232,7 +268,7 @@ void vInit_playscreen(unsigned int inf_lives,
     }
 
     // initialize laser
-    laser.lock = xSemaphoreCreateMutex();
+    laser.lock = xPlayLock(laser.lock);
     if (xSemaphoreTake(laser.lock, portMAX_DELAY)) {
 
         laser.x_coord = 0;
@@ -246,7 +282,7 @@ void vInit_playscreen(unsigned int inf_lives,
         xSemaphoreGive(laser.lock);
     }
     // initialize explosion
-    explosion.lock = xSemaphoreCreateMutex();
+    explosion.lock = xPlayLock(explosion.lock);
     if (xSemaphoreTake(explosion.lock, portMAX_DELAY)) {
 
         explosion.x_coord = 0;
@@ -263,7 +299,7 @@ void vInit_playscreen(unsigned int inf_lives,
     }
     // initialize bunkers
     for (int row=0; row<4; row++) {
-        bunkers[row].lock = xSemaphoreCreateMutex();
+        bunkers[row].lock = xPlayLock(bunkers[row].lock);
         if (xSemaphoreTake(bunkers[row].lock, portMAX_DELAY)) {
 
             bunkers[row].x_coord = 145 + 100*row;
@@ -344,16 +380,15 @@ int vGet_highScore()
     return gamedata.hscore;
 }
 
-int vDraw_playscreen(unsigned int Flags[5], unsigned int ms)
+int vUpdate_playscreen(unsigned int Flags[5], unsigned int ms)
 {
+    PROF_ZONE("update");
 
     if (vCheck_aliensleft()) {     // when no aliens left progress to nxt lvl
         
         return 2;
     }
 
-    vDrawStaticItems(); 
-
     if (gamedata.score1 > gamedata.hscore) {
         gamedata.hscore = gamedata.score1;
     }
@@ -386,18 +421,32 @@ int vDraw_playscreen(unsigned int Flags[5], unsigned int ms)
 
     // check collisions returns 1 when collision alien player occurs
     if (vCheckCollisions() || gamedata.lives == 0) {    
-        vDrawGameOver();
         return 1;
     }
 
     vUpdatePositions(Flags, ms);    // update positions
-
-    vDrawDynamicItems();        // draw dynamic items
-    
     
     return 0;
 }
 
+void vDraw_playscreen(int state)
+{
+    PROF_ZONE("draw");
+
+    if (state == 2) {   // the next level screen takes over
+        return;
+    }
+
+    vDrawStaticItems();
+
+    if (state == 1) {
+        vDrawGameOver();
+        return;
+    }
+
+    vDrawDynamicItems();        // draw dynamic items
+}
+
 int vGet_deltaX()
 {
     signed int deltaX = 0;
@@ -430,6 +479,8 @@ int vGet_difficulty()
 
 int vCheckCollisions() 
 {
+    PROF_ZONE("collisions");
+
     /**
      * 1. check collision projectile and alien -
      * 2. check collision projectile and bunker - 
@@ -462,6 +513,7 @@ int vCheckCollisions()
 
             xSemaphoreGive(explosion.lock);
         }
+        tumSoundPlaySample(SOUND_ALIEN_HIT);
         vDelete_projectile();
     }
     
@@ -506,6 +558,8 @@ int vCheckCollisions()
 
 void vUpdatePositions(unsigned int Flags[4], unsigned int ms)
 {
+    PROF_ZONE("positions");
+
     /**
      * 1. update aliens positions
      * 2. update projectile position
@@ -534,6 +588,8 @@ void vUpdatePositions(unsigned int Flags[4], unsigned int ms)
 
 void vDrawDynamicItems() 
 {
+    PROF_ZONE("dynamic");
+
     /**
      * 1. draw Scores
      * 2. draw Aliens
@@ -828,6 +884,8 @@ int vCheckCollision_proj_mothership()
 
                 explosion.state = 1;
 
+                tumSoundPlaySample(SOUND_MOTHERSHIP_HIT);
+
                 return 1;
             }
         }
@@ -1375,6 +1433,8 @@ void vCreate_projectile() {
         projectile.state = 1;
 
         xSemaphoreGive(projectile.lock);
+
+        tumSoundPlaySample(SOUND_SHOT);
     }
 }
 
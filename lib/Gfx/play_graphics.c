@@ -20,6 +20,7 @@
 #include "TUM_Font.h"
 
 #include "play_graphics.h"
+#include "prof_zone.h"
 
 #define CENTER_X SCREEN_WIDTH/2
 #define CENTER_Y SCREEN_HEIGHT/2
@@ -29,6 +30,8 @@
 
 void vDrawStaticItems()
 {
+    PROF_ZONE("static");
+
     // coordinates of Gamescreen
     signed short x_playscreen = 100;
     signed short y_playscreen = 0;
@@ -74,6 +77,7 @@ void vDrawStaticItems()
 }
 
 void vDrawPlayer(signed short pos_x, signed short pos_y) {
+    PROF_ZONE("player");
 
     unsigned int color = Green;
 
@@ -86,7 +90,8 @@ void vDrawPlayer(signed short pos_x, signed short pos_y) {
 }
 
 void vDrawBunker(signed short pos_x, signed short pos_y) {
-    
+    PROF_ZONE("bunker");
+
     unsigned int color = Green;
 
     tumDrawFilledBox(pos_x + 4*px, pos_y - 4 *px, 
@@ -118,6 +123,8 @@ void vDrawBunker(signed short pos_x, signed short pos_y) {
 void vDraw_fredAlien(signed short pos_x, signed short pos_y, 
                         signed short state)
 {
+    PROF_ZONE("fred");
+
     unsigned int primary_color = White;    
     unsigned int secondary_color = Black;
 
@@ -175,6 +182,8 @@ void vDraw_fredAlien(signed short pos_x, signed short pos_y,
 void vDraw_crabAlien(signed short pos_x, signed short pos_y,
                         signed short state) 
 {
+    PROF_ZONE("crab");
+
     unsigned int primary_color = White;    
     unsigned int secondary_color = Black;
 
@@ -245,6 +254,8 @@ void vDraw_crabAlien(signed short pos_x, signed short pos_y,
 void vDraw_jellyAlien(signed short pos_x, signed short pos_y,
                         signed short state)
 {
+    PROF_ZONE("jelly");
+
     unsigned int primary_color = White;    
     unsigned int secondary_color = Black;
 
@@ -305,11 +316,14 @@ void vDraw_jellyAlien(signed short pos_x, signed short pos_y,
 
 void vDrawProjectile(signed short pos_x, signed short pos_y)
 {   
+    PROF_ZONE("projectile");
     tumDrawFilledBox(pos_x, pos_y, px, 2*px, Green);
 }
 
 void vDrawMotherShip(signed short pos_x, signed short pos_y)
 {
+    PROF_ZONE("mothership");
+
     unsigned int primary_color = Red;    
     unsigned int secondary_color = Black;
 
@@ -348,6 +362,7 @@ void vDrawMotherShip(signed short pos_x, signed short pos_y)
 }
 
 void vDrawExplosion(signed short pos_x, signed short pos_y) {
+    PROF_ZONE("explosion");
 
     unsigned int primary_color = Orange;
     unsigned int secondary_color = Red;
@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "TUM_Utils.h"
+#include "replay.h"
+
+#define REPLAY_MAGIC "SIRP"
+#define REPLAY_VERSION 1
+
+#define FNV_OFFSET 2166136261u
+#define FNV_PRIME 16777619u
+
+#define NS_IN_MS 1000000.0
+
+// largest frame: header, events with a 5 byte code, commands
+#define FRAME_BUFFER_SIZE (1 + 5 + 2 + REPLAY_MAX_EVENTS * 10 + \
+                           REPLAY_MAX_COMMANDS * AI_CMD_LEN)
+
+/**
+ * Only the frame task records or replays, exit handlers completing the
+ * file may run on any task, so frames are written in one piece within a
+ * critical section. The digest is folded before a frame is written, the
+ * end record holds the digest as of the last complete frame.
+ */
+static struct {
+    int mode;
+    FILE *fp;
+    TickType_t last_tick;
+    uint32_t frames;
+    uint32_t digest;
+    uint32_t written_digest;
+    uint64_t start;
+} replay = { .mode = REPLAY_OFF, .digest = FNV_OFFSET,
+              .written_digest = FNV_OFFSET };
+
+static void vReplayReset(int mode)
+{
+    replay.mode = mode;
+    replay.last_tick = 0;
+    replay.frames = 0;
+    replay.digest = FNV_OFFSET;
+    replay.written_digest = FNV_OFFSET;
+}
+
+static unsigned char *pucPutVar(unsigned char *p, uint32_t value)
+{
+    do {
+        *p = value & 0x7f;
+        value >>= 7;
+        if (value) {
+            *p |= 0x80;
+        }
+        p++;
+    } while (value);
+
+    return p;
+}
+
+static unsigned char *pucPut16(unsigned char *p, uint16_t value)
+{
+    *p++ = value & 0xff;
+    *p++ = value >> 8;
+
+    return p;
+}
+
+static unsigned char *pucPut32(unsigned char *p, uint32_t value)
+{
+    p = pucPut16(p, value & 0xffff);
+
+    return pucPut16(p, value >> 16);
+}
+
+static int xGetByte(unsigned char *value)
+{
+    int c = fgetc(replay.fp);
+
+    if (c == EOF) {
+        return -1;
+    }
+    *value = c;
+
+    return 0;
+}
+
+static int xGetVar(uint32_t *value)
+{
+    unsigned char c;
+    unsigned int shift = 0;
+
+    *value = 0;
+    do {
+        if (xGetByte(&c) || shift > 28) {
+            return -1;
+        }
+        *value |= (uint32_t)(c & 0x7f) << shift;
+        shift += 7;
+    } while (c & 0x80);
+
+    return 0;
+}
+
+static int xGet16(uint16_t *value)
+{
+    unsigned char lo, hi;
+
+    if (xGetByte(&lo) || xGetByte(&hi)) {
+        return -1;
+    }
+    *value = lo | hi << 8;
+
+    return 0;
+}
+
+static int xGet32(uint32_t *value)
+{
+    uint16_t lo, hi;
+
+    if (xGet16(&lo) || xGet16(&hi)) {
+        return -1;
+    }
+    *value = lo | (uint32_t)hi << 16;
+
+    return 0;
+}
+
+int xReplayRecord(const char *path, unsigned int seed)
+{
+    unsigned char header[9];
+
+    replay.fp = fopen(path, "wb");
+    if (!replay.fp) {
+        perror("replay");
+        return -1;
+    }
+
+    memcpy(header, REPLAY_MAGIC, 4);
+    header[4] = REPLAY_VERSION;
+    pucPut32(&header[5], seed);
+    fwrite(header, sizeof(header), 1, replay.fp);
+
+    vReplayReset(REPLAY_RECORD);
+
+    return 0;
+}
+
+int xReplayPlay(const char *path, unsigned int *seed)
+{
+    char magic[4];
+    unsigned char version;
+    uint32_t value;
+
+    replay.fp = fopen(path, "rb");
+    if (!replay.fp) {
+        perror("replay");
+        return -1;
+    }
+
+    if (fread(magic, sizeof(magic), 1, replay.fp) != 1 ||
+        memcmp(magic, REPLAY_MAGIC, 4) || xGetByte(&version) ||
+        version != REPLAY_VERSION || xGet32(&value)) {
+        fprintf(stderr, "[ERROR] replay: %s is no recording\n", path);
+        fclose(replay.fp);
+        replay.fp = NULL;
+        return -1;
+    }
+
+    *seed = value;
+    vReplayReset(REPLAY_PLAY);
+    replay.start = tumUtilTimeNs();
+
+    return 0;
+}
+
+int xReplayMode(void)
+{
+    return replay.mode;
+}
+
+int xReplayWriteFrame(const replay_frame_t *frame)
+{
+    static unsigned char buffer[FRAME_BUFFER_SIZE];
+    unsigned char *p = buffer;
+    unsigned int i, len;
+    int ret = 0;
+
+    *p++ = 'F';
+    p = pucPutVar(p, frame->tick - replay.last_tick);
+    *p++ = frame->event_count;
+    *p++ = frame->command_count;
+
+    for (i = 0; i < frame->event_count; i++) {
+        *p++ = frame->events[i].type;
+        p = pucPutVar(p, frame->events[i].code);
+        p = pucPut16(p, frame->events[i].x);
+        p = pucPut16(p, frame->events[i].y);
+    }
+    for (i = 0; i < frame->command_count; i++) {
+        len = strnlen(frame->commands[i], AI_CMD_LEN - 1);
+        *p++ = len;
+        memcpy(p, frame->commands[i], len);
+        p += len;
+    }
+
+    replay.last_tick = frame->tick;
+
+    taskENTER_CRITICAL();
+    if (replay.mode == REPLAY_RECORD) {
+        if (fwrite(buffer, p - buffer, 1, replay.fp) == 1) {
+            replay.frames++;
+            replay.written_digest = replay.digest;
+        } else {
+            ret = -1;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return ret;
+}
+
+int xReplayReadFrame(replay_frame_t *frame)
+{
+    unsigned char tag, count, type, len;
+    uint32_t dt, code;
+    uint16_t x, y;
+    unsigned int i;
+
+    if (replay.mode != REPLAY_PLAY || xGetByte(&tag) || tag != 'F') {
+        return -1;
+    }
+
+    if (xGetVar(&dt) || xGetByte(&count) || count > REPLAY_MAX_EVENTS) {
+        return -1;
+    }
+    frame->event_count = count;
+    if (xGetByte(&count) || count > REPLAY_MAX_COMMANDS) {
+        return -1;
+    }
+    frame->command_count = count;
+
+    replay.last_tick += dt;
+    frame->tick = replay.last_tick;
+
+    for (i = 0; i < frame->event_count; i++) {
+        if (xGetByte(&type) || xGetVar(&code) || xGet16(&x) || xGet16(&y)) {
+            return -1;
+        }
+        frame->events[i].time_ns = 0;
+        frame->events[i].type = type;
+        frame->events[i].code = code;
+        frame->events[i].x = x;
+        frame->events[i].y = y;
+    }
+    for (i = 0; i < frame->command_count; i++) {
+        if (xGetByte(&len) || len >= AI_CMD_LEN ||
+            fread(frame->commands[i], 1, len, replay.fp) != len) {
+            return -1;
+        }
+        frame->commands[i][len] = '\0';
+    }
+
+    replay.frames++;
+
+    return 0;
+}
+
+void vReplayDigest(uint32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        replay.digest ^= (value >> (i * 8)) & 0xff;
+        replay.digest *= FNV_PRIME;
+    }
+}
+
+void vReplayClose(void)
+{
+    unsigned char end[9];
+    unsigned char tag;
+    uint32_t frames, digest;
+    int mode;
+
+    taskENTER_CRITICAL();
+    mode = replay.mode;
+    replay.mode = REPLAY_OFF;
+    if (mode == REPLAY_RECORD) {
+        end[0] = 'E';
+        pucPut32(&end[1], replay.frames);
+        pucPut32(&end[5], replay.written_digest);
+        fwrite(end, sizeof(end), 1, replay.fp);
+        fclose(replay.fp);
+    }
+    taskEXIT_CRITICAL();
+
+    if (mode == REPLAY_RECORD) {
+        printf("Recorded %u frames\n", replay.frames);
+        return;
+    }
+    if (mode != REPLAY_PLAY) {
+        return;
+    }
+
+    printf("Replayed %u frames in %.1f ms\n", replay.frames,
+           (tumUtilTimeNs() - replay.start) / NS_IN_MS);
+
+    if (fseek(replay.fp, -9, SEEK_END) || xGetByte(&tag) || tag != 'E' ||
+        xGet32(&frames) || xGet32(&digest)) {
+        printf("Recording is incomplete, no digest to compare\n");
+    } else if (frames != replay.frames) {
+        printf("Replay stopped after %u of %u frames\n", replay.frames,
+               frames);
+    } else if (digest != replay.digest) {
+        printf("Replay DIVERGED from the recording, digest %08x "
+               "instead of %08x\n", replay.digest, digest);
+    } else {
+        printf("Replay identical to the recording, digest %08x\n", digest);
+    }
+    fclose(replay.fp);
+}
@@ -0,0 +1,186 @@
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "TUM_Utils.h"
+#include "screen_manager.h"
+
+#define NS_IN_US 1000
+
+/**
+ * Only the frame task touches the manager, so nothing here is locked.
+ * requested_at is set when a change is accepted and cleared once the
+ * new screen has drawn its first frame.
+ */
+static struct {
+    const screen_t *screens[SCREEN_MAX];
+    int current;
+    int pending;
+    int timed;
+    TickType_t timed_from;
+    TickType_t timed_delay;
+    TickType_t holdoff;
+    TickType_t last_change;
+    uint64_t requested_at;
+    TickType_t (*now)(void);
+    screen_stats_t stats;
+} manager = { .current = SCREEN_NONE, .pending = SCREEN_NONE,
+              .timed = SCREEN_NONE, .now = xTaskGetTickCount };
+
+static int xIsRegistered(int id)
+{
+    return id >= 0 && id < SCREEN_MAX && manager.screens[id];
+}
+
+static void vApplyPending(void)
+{
+    const screen_t *from, *to;
+    int from_id = manager.current;
+
+    if (manager.pending == SCREEN_NONE) {
+        return;
+    }
+
+    from = manager.screens[from_id];
+    to = manager.screens[manager.pending];
+
+    manager.current = manager.pending;
+    manager.pending = SCREEN_NONE;
+    manager.timed = SCREEN_NONE;
+
+    if (from->exit) {
+        from->exit(manager.current);
+    }
+    if (to->enter) {
+        to->enter(from_id);
+    }
+
+    manager.last_change = manager.now();
+    manager.stats.transitions++;
+}
+
+void vScreenSetClock(TickType_t (*now)(void))
+{
+    manager.now = now ? now : xTaskGetTickCount;
+}
+
+int xScreenRegister(int id, const screen_t *screen)
+{
+    if (id < 0 || id >= SCREEN_MAX || !screen) {
+        return -1;
+    }
+
+    manager.screens[id] = screen;
+
+    return 0;
+}
+
+int xScreenStart(int id, TickType_t holdoff)
+{
+    if (!xIsRegistered(id)) {
+        return -1;
+    }
+
+    manager.holdoff = holdoff;
+    manager.current = id;
+    manager.last_change = manager.now();
+
+    if (manager.screens[id]->enter) {
+        manager.screens[id]->enter(SCREEN_NONE);
+    }
+
+    return 0;
+}
+
+int xScreenRequest(int id)
+{
+    if (!xIsRegistered(id) || manager.current == SCREEN_NONE) {
+        return -1;
+    }
+
+    if (manager.pending != SCREEN_NONE ||
+        manager.now() - manager.last_change <= manager.holdoff) {
+        manager.stats.ignored++;
+        return -1;
+    }
+
+    manager.pending = id;
+    manager.requested_at = tumUtilTimeNs();
+
+    return 0;
+}
+
+int xScreenRequestAfter(int id, TickType_t delay)
+{
+    if (!xIsRegistered(id) || manager.current == SCREEN_NONE) {
+        return -1;
+    }
+
+    manager.timed = id;
+    manager.timed_from = manager.now();
+    manager.timed_delay = delay;
+
+    return 0;
+}
+
+int xScreenCurrent(void)
+{
+    return manager.current;
+}
+
+void vScreenUpdate(void)
+{
+    const screen_t *screen;
+
+    if (manager.current == SCREEN_NONE) {
+        return;
+    }
+
+    if (manager.timed != SCREEN_NONE && manager.pending == SCREEN_NONE &&
+        manager.now() - manager.timed_from >= manager.timed_delay) {
+        manager.pending = manager.timed;
+        manager.requested_at = tumUtilTimeNs();
+    }
+
+    // changes requested outside of an update, e.g. while drawing
+    vApplyPending();
+
+    screen = manager.screens[manager.current];
+    if (screen->update) {
+        screen->update();
+    }
+
+    vApplyPending();
+}
+
+void vScreenDraw(void)
+{
+    const screen_t *screen;
+    unsigned long latency;
+
+    if (manager.current == SCREEN_NONE) {
+        return;
+    }
+
+    screen = manager.screens[manager.current];
+    if (screen->draw) {
+        screen->draw();
+    }
+
+    if (manager.requested_at && manager.pending == SCREEN_NONE) {
+        latency = (tumUtilTimeNs() - manager.requested_at) / NS_IN_US;
+        manager.requested_at = 0;
+
+        manager.stats.last_us = latency;
+        manager.stats.total_us += latency;
+        if (latency > manager.stats.max_us) {
+            manager.stats.max_us = latency;
+        }
+    }
+}
+
+void vScreenGetStats(screen_stats_t *stats)
+{
+    *stats = manager.stats;
+}
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "TUM_Utils.h"
+#include "frame_timing.h"
+
+#define SUB_BUCKETS (1 << FRAME_TIMING_SUB_BITS)
+// values from 2^MAX_EXP ns (about 18 minutes) on share the last bucket
+#define MAX_EXP 40
+#define BUCKETS ((MAX_EXP - FRAME_TIMING_SUB_BITS + 1) * SUB_BUCKETS)
+
+#define NS_IN_MS 1000000ULL
+
+typedef struct histogram {
+    uint32_t counts[BUCKETS];
+    unsigned long count;
+    uint64_t total;
+    uint64_t max;
+} histogram_t;
+
+static const char *phase_names[FRAME_PHASES] = {
+    "input", "sim", "record", "render", "present", "frame"
+};
+
+/**
+ * window collects the current period and becomes last once it is over,
+ * all histograms are only touched in critical sections
+ */
+static struct {
+    histogram_t all[FRAME_PHASES];
+    histogram_t window[FRAME_PHASES];
+    histogram_t last[FRAME_PHASES];
+    uint64_t window_start;
+} timing = { 0 };
+
+static unsigned int uiBucket(uint64_t ns)
+{
+    unsigned int exp;
+
+    if (ns < SUB_BUCKETS) {
+        return ns;
+    }
+
+    exp = 63 - __builtin_clzll(ns);
+    if (exp >= MAX_EXP) {
+        return BUCKETS - 1;
+    }
+
+    return (exp - FRAME_TIMING_SUB_BITS + 1) * SUB_BUCKETS +
+           (ns >> (exp - FRAME_TIMING_SUB_BITS)) - SUB_BUCKETS;
+}
+
+/** Highest value counted by a bucket */
+static uint64_t xBucketTop(unsigned int bucket)
+{
+    unsigned int block = bucket / SUB_BUCKETS;
+    unsigned int sub = bucket % SUB_BUCKETS;
+
+    if (!block) {
+        return bucket;
+    }
+
+    return ((uint64_t)(SUB_BUCKETS + sub + 1) << (block - 1)) - 1;
+}
+
+static void vAdd(histogram_t *h, uint64_t ns)
+{
+    h->counts[uiBucket(ns)]++;
+    h->count++;
+    h->total += ns;
+    if (ns > h->max) {
+        h->max = ns;
+    }
+}
+
+static uint64_t xPercentile(const histogram_t *h, double percentile)
+{
+    unsigned long seen = 0;
+    unsigned int i;
+
+    for (i = 0; i < BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen && seen >= h->count * percentile) {
+            break;
+        }
+    }
+
+    if (i == BUCKETS || xBucketTop(i) > h->max) {
+        return h->max;
+    }
+
+    return xBucketTop(i);
+}
+
+void vFrameTimingRecord(int phase, uint64_t ns)
+{
+    uint64_t now = 0;
+
+    if (phase < 0 || phase >= FRAME_PHASES) {
+        return;
+    }
+
+    // once per frame is enough to end the period
+    if (phase == FRAME_PHASE_FRAME) {
+        now = tumUtilTimeNs();
+    }
+
+    taskENTER_CRITICAL();
+    vAdd(&timing.all[phase], ns);
+    vAdd(&timing.window[phase], ns);
+
+    if (now && now - timing.window_start >=
+        FRAME_TIMING_PERIOD_MS * NS_IN_MS) {
+        memcpy(timing.last, timing.window, sizeof(timing.last));
+        memset(timing.window, 0, sizeof(timing.window));
+        timing.window_start = now;
+    }
+    taskEXIT_CRITICAL();
+}
+
+static void vSummarize(const histogram_t *h, frame_timing_t *t)
+{
+    t->count = h->count;
+    if (!h->count) {
+        t->mean_ms = t->p50_ms = t->p99_ms = t->max_ms = 0;
+        return;
+    }
+
+    t->mean_ms = (double)h->total / h->count / NS_IN_MS;
+    t->p50_ms = (double)xPercentile(h, 0.5) / NS_IN_MS;
+    t->p99_ms = (double)xPercentile(h, 0.99) / NS_IN_MS;
+    t->max_ms = (double)h->max / NS_IN_MS;
+}
+
+void vFrameTimingGet(int phase, frame_timing_t *t)
+{
+    static histogram_t h;
+
+    if (phase < 0 || phase >= FRAME_PHASES) {
+        memset(t, 0, sizeof(frame_timing_t));
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    memcpy(&h, &timing.last[phase], sizeof(h));
+    taskEXIT_CRITICAL();
+
+    vSummarize(&h, t);
+}
+
+const char *pcFrameTimingName(int phase)
+{
+    if (phase < 0 || phase >= FRAME_PHASES) {
+        return "?";
+    }
+
+    return phase_names[phase];
+}
+
+void vFrameTimingReport(FILE *fp)
+{
+    static histogram_t all[FRAME_PHASES];
+    histogram_t *h;
+    int i;
+
+    taskENTER_CRITICAL();
+    memcpy(all, timing.all, sizeof(all));
+    taskEXIT_CRITICAL();
+
+    fprintf(fp, "Frame timing in ms, %lu frames\n",
+            all[FRAME_PHASE_FRAME].count);
+    fprintf(fp, "%-8s %9s %9s %9s %9s %9s %9s\n", "phase", "mean", "p50",
+            "p90", "p99", "p99.9", "max");
+
+    for (i = 0; i < FRAME_PHASES; i++) {
+        h = &all[i];
+        if (!h->count) {
+            continue;
+        }
+
+        fprintf(fp, "%-8s %9.3f %9.3f %9.3f %9.3f %9.3f %9.3f\n",
+                phase_names[i], (double)h->total / h->count / NS_IN_MS,
+                (double)xPercentile(h, 0.5) / NS_IN_MS,
+                (double)xPercentile(h, 0.9) / NS_IN_MS,
+                (double)xPercentile(h, 0.99) / NS_IN_MS,
+                (double)xPercentile(h, 0.999) / NS_IN_MS,
+                (double)h->max / NS_IN_MS);
+    }
+}
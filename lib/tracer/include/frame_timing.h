@@ -0,0 +1,78 @@
+#ifndef __FRAME_TIMING_H__
+#define __FRAME_TIMING_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/**
+ * @defgroup frame_timing Frame timing API
+ *
+ * Durations of the phases of every frame in nanoseconds
+ *
+ * Each phase is kept in an HDR style histogram: values below
+ * 2^FRAME_TIMING_SUB_BITS ns are counted exactly, every larger power of
+ * two range is split into 2^FRAME_TIMING_SUB_BITS linear buckets, so
+ * percentiles are accurate to about 3% from nanoseconds up to minutes.
+ * There is one histogram over the whole run, printed by
+ * vFrameTimingReport(), and one per FRAME_TIMING_PERIOD_MS, the last
+ * complete one is returned by vFrameTimingGet() for display.
+ *
+ * Phases may be recorded from different tasks.
+ */
+
+#define FRAME_TIMING_SUB_BITS 5
+#define FRAME_TIMING_PERIOD_MS 1000
+
+enum {
+    FRAME_PHASE_INPUT = 0,  /**< reading the input */
+    FRAME_PHASE_SIMULATE,   /**< updating the current screen */
+    FRAME_PHASE_RECORD,     /**< queueing the draw jobs */
+    FRAME_PHASE_RENDER,     /**< executing the draw jobs */
+    FRAME_PHASE_PRESENT,    /**< presenting, including vsync */
+    FRAME_PHASE_FRAME,      /**< time between two presents */
+    FRAME_PHASES
+};
+
+/**
+ * @brief Summary of one phase, all times in ms
+ */
+typedef struct frame_timing {
+    unsigned long count; /**< Frames recorded */
+    float mean_ms;
+    float p50_ms;
+    float p99_ms;
+    float max_ms;
+} frame_timing_t;
+
+/**
+ * @brief Records the duration of a phase
+ *
+ * @param phase One of FRAME_PHASE_*
+ * @param ns Duration in ns
+ */
+void vFrameTimingRecord(int phase, uint64_t ns);
+
+/**
+ * @brief Summary of a phase over the last complete period
+ *
+ * @param phase One of FRAME_PHASE_*
+ * @param timing Filled with the summary
+ */
+void vFrameTimingGet(int phase, frame_timing_t *timing);
+
+/**
+ * @brief Short name of a phase
+ */
+const char *pcFrameTimingName(int phase);
+
+/**
+ * @brief Prints count, mean, percentiles and max of every phase over the
+ * whole run
+ *
+ * @param fp File to print to
+ */
+void vFrameTimingReport(FILE *fp);
+
+#endif
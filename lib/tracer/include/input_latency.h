@@ -0,0 +1,78 @@
+#ifndef __INPUT_LATENCY_H__
+#define __INPUT_LATENCY_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/**
+ * @defgroup input_latency Input latency API
+ *
+ * Time from an input event until the frame showing its effect has been
+ * presented
+ *
+ * The frame task marks the start of every frame, reports the inputs whose
+ * effect it draws into that frame with their event time and marks the
+ * frame as submitted once all draw jobs are queued. The task presenting
+ * the frame then closes it after SDL_RenderPresent() returned. Every
+ * input is split into three stages, each kept in a log2 histogram:
+ *
+ * - queued: event time until the frame task picked it up
+ * - frame: frame start until the draw jobs were submitted
+ * - present: submission until SDL_RenderPresent() returned
+ *
+ * together with the total. Submitting and presenting must not overlap,
+ * which the ScreenLock guarantees in main.c.
+ */
+
+/**
+ * Histogram buckets, bucket n counts times below 2^n microseconds and
+ * the last bucket everything longer
+ */
+#define INPUT_LATENCY_BUCKETS 20
+
+/**
+ * Max. number of inputs with an effect in a single frame
+ */
+#define INPUT_LATENCY_PER_FRAME 8
+
+#if (configUSE_INPUT_LATENCY == 1)
+
+/**
+ * @brief Starts a new frame, call once input has been read
+ */
+void vInputLatencyFrameStart(void);
+
+/**
+ * @brief The current frame shows the effect of an input
+ *
+ * @param input_ns Time of the input event
+ */
+void vInputLatencyEffect(int64_t input_ns);
+
+/**
+ * @brief All draw jobs of the current frame have been submitted
+ */
+void vInputLatencyFrameSubmitted(void);
+
+/**
+ * @brief The last submitted frame has been presented
+ */
+void vInputLatencyPresented(void);
+
+/**
+ * @brief Number of inputs measured so far
+ */
+unsigned long ulInputLatencySamples(void);
+
+/**
+ * @brief Prints count, mean, percentiles and histogram of every stage
+ *
+ * @param fp File to print to
+ */
+void vInputLatencyReport(FILE *fp);
+
+#endif
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef __LOCK_PROF_H__
+#define __LOCK_PROF_H__
+
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+/**
+ * @defgroup lock_prof Lock profiler API
+ *
+ * Contention profile of the semaphores and mutexes taken by the game
+ *
+ * In a -DLOCK_PROFILE build, including this header after semphr.h routes
+ * xSemaphoreTake(), xSemaphoreGive() and vSemaphoreDelete() of that file
+ * through the profiler. Every lock is named after the expression used in
+ * its first xSemaphoreTake(), locks sharing a name, e.g. the mutex of
+ * every alien, are reported together.
+ *
+ * Per lock the profiler counts takes, failed try-takes (zero block time)
+ * and timeouts, and keeps log2 histograms of the time spent waiting in
+ * xSemaphoreTake() and, for mutexes, of the time the mutex was held.
+ * vLockProfReport() lists the locks with the most total wait first.
+ *
+ * Without LOCK_PROFILE the header has no effect.
+ */
+
+/**
+ * Max. number of live locks and of distinct lock names
+ */
+#define LOCK_PROF_MAX_LOCKS 1024
+#define LOCK_PROF_MAX_NAMES 64
+
+/**
+ * Histogram buckets, bucket n counts times below 2^n microseconds and
+ * the last bucket everything longer
+ */
+#define LOCK_PROF_BUCKETS 16
+
+#if (configUSE_LOCK_PROFILE == 1)
+
+BaseType_t xLockProfTake(SemaphoreHandle_t lock, TickType_t block_time,
+                         const char *name);
+BaseType_t xLockProfGive(SemaphoreHandle_t lock);
+void vLockProfDelete(SemaphoreHandle_t lock);
+
+/**
+ * @brief Prints the profile of all locks, hottest first
+ *
+ * @param fp File to print to
+ */
+void vLockProfReport(FILE *fp);
+
+#ifndef LOCK_PROF_IMPLEMENTATION
+#undef xSemaphoreTake
+#undef xSemaphoreGive
+#undef vSemaphoreDelete
+#define xSemaphoreTake(xSemaphore, xBlockTime) \
+    xLockProfTake((xSemaphore), (xBlockTime), #xSemaphore)
+#define xSemaphoreGive(xSemaphore) xLockProfGive(xSemaphore)
+#define vSemaphoreDelete(xSemaphore) vLockProfDelete(xSemaphore)
+#endif
+
+#endif
+
+#endif
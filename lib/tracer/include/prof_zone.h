@@ -0,0 +1,109 @@
+#ifndef __PROF_ZONE_H__
+#define __PROF_ZONE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+
+/**
+ * @defgroup prof_zone Profiling zone API
+ *
+ * CPU time of named code zones, aggregated per frame
+ *
+ * PROF_ZONE("name"); at the top of a block times the rest of that block
+ * in nanoseconds, the zone is closed when the block is left, including
+ * by return. Zones may nest, every zone counts its inclusive time. Each
+ * frame vProfFrameEnd() adds the calls and time of every zone during the
+ * frame to a per period summary, returned by uiProfZonesGet() for the
+ * overlay, and appends them to a CSV file as
+ *
+ *     frame,zone,calls,ns
+ *
+ * with one line per zone entered during the frame. Zones only time the
+ * CPU side, drawing functions queue their draw jobs, which are executed
+ * when the frame is rendered.
+ *
+ * Zones and vProfFrameEnd() must be used by a single task, the frame
+ * task. Without PROF_ZONES builds PROF_ZONE() expands to nothing.
+ */
+
+/**
+ * Max. number of zones, zones entered later are not timed
+ */
+#define PROF_MAX_ZONES 32
+#define PROF_PERIOD_MS 1000
+
+/**
+ * @brief Summary of one zone over the last complete period
+ */
+typedef struct prof_zone_stats {
+    const char *name; /**< Zone name */
+    float calls; /**< Calls per frame */
+    float mean_us; /**< CPU time per frame */
+    float max_us; /**< Longest CPU time within a frame */
+} prof_zone_stats_t;
+
+#if (configUSE_PROF_ZONES == 1)
+
+typedef struct prof_zone {
+    const char *name;
+    int id; /**< index in the zone table, -1 until first entered */
+} prof_zone_t;
+
+typedef struct prof_scope {
+    prof_zone_t *zone;
+    uint64_t start;
+} prof_scope_t;
+
+prof_scope_t xProfScopeEnter(prof_zone_t *zone);
+void vProfScopeExit(prof_scope_t *scope);
+
+#define PROF_CONCAT_(a, b) a##b
+#define PROF_CONCAT(a, b) PROF_CONCAT_(a, b)
+
+#define PROF_ZONE(zone_name)                                               \
+    static prof_zone_t PROF_CONCAT(prof_zone_, __LINE__) =                 \
+        { (zone_name), -1 };                                               \
+    prof_scope_t PROF_CONCAT(prof_scope_, __LINE__)                        \
+        __attribute__((cleanup(vProfScopeExit))) =                         \
+        xProfScopeEnter(&PROF_CONCAT(prof_zone_, __LINE__))
+
+/**
+ * @brief Starts profiling
+ *
+ * @param csv_path File the zones of every frame are written to, NULL for
+ * none, it is closed on exit
+ * @return 0 on success, -1 otherwise
+ */
+int xProfZonesStart(const char *csv_path);
+
+/**
+ * @brief Ends the current frame, call once per frame after all zones
+ */
+void vProfFrameEnd(void);
+
+/**
+ * @brief Copies the summary of the last period, in order of first use
+ *
+ * @param stats Array receiving the summaries
+ * @param max Length of the array
+ * @return Number of zones copied
+ */
+unsigned int uiProfZonesGet(prof_zone_stats_t *stats, unsigned int max);
+
+/**
+ * @brief Prints calls, mean and max per frame of every zone over the whole
+ * run
+ *
+ * @param fp File to print to
+ */
+void vProfZonesReport(FILE *fp);
+
+#else
+
+#define PROF_ZONE(zone_name)
+
+#endif
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef __SCHED_TRACE_H__
+#define __SCHED_TRACE_H__
+
+/**
+ * @defgroup sched_trace Scheduler trace API
+ *
+ * Records kernel events of a -DSCHED_TRACE build for chrome://tracing
+ * and https://ui.perfetto.dev
+ *
+ * The kernel trace hooks set up in trace_hooks.h append task switches,
+ * ticks and every send, receive and block on a queue, semaphore or mutex
+ * to a lock-free ring holding the last SCHED_TRACE_EVENTS events. The ring
+ * is exported as Chrome JSON trace when the process exits:
+ *
+ * - every task is a thread whose slices are the times it was running
+ * - ticks are instant events on their own "Ticks" thread
+ * - semaphore and queue operations are instant events on the task that
+ *   performed them, mutex holds are async slices named after the mutex
+ *
+ * Queues, semaphores and mutexes are named after their entry in the
+ * queue registry, see vQueueAddToRegistry().
+ */
+
+/**
+ * Number of events kept, must be a power of two
+ */
+#define SCHED_TRACE_EVENTS (1 << 18)
+
+/**
+ * @brief Starts recording, the trace is written to path on exit
+ *
+ * @param path Chrome JSON file to write
+ * @return 0 on success, -1 otherwise
+ */
+int xSchedTraceStart(const char *path);
+
+/**
+ * @brief Writes the events recorded so far as Chrome JSON trace
+ *
+ * @param path File to write
+ * @return 0 on success, -1 otherwise
+ */
+int xSchedTraceExport(const char *path);
+
+#endif
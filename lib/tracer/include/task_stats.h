@@ -0,0 +1,74 @@
+#ifndef __TASK_STATS_H__
+#define __TASK_STATS_H__
+
+#include <stdio.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/**
+ * @defgroup task_stats Task statistics API
+ *
+ * Per task CPU time and context switch accounting
+ *
+ * The kernel's run-time statistics provide the CPU time of every task,
+ * counted in microseconds by the POSIX port. On top of that the
+ * traceTASK_SWITCHED_IN/OUT hooks set up in FreeRTOSConfig.h count how
+ * often each task got the CPU, how often it gave it up because it blocked
+ * and how long it stayed blocked at most.
+ *
+ * A low priority task samples all counters once per period, the latest
+ * sample can be read at any time and is appended to a CSV file with the
+ * columns
+ *
+ * time_ms,task,state,cpu_us,cpu_pct,switches,blocks,max_block_us,total_cpu_ms
+ *
+ * where all but total_cpu_ms refer to the last period only.
+ */
+
+/**
+ * Max. number of tasks accounted, tasks created later are ignored
+ */
+#define TASK_STATS_MAX_TASKS 32
+
+/**
+ * @brief Statistics of a single task over the last sampling period
+ */
+typedef struct task_stats {
+    char name[configMAX_TASK_NAME_LEN]; /**< Task name */
+    unsigned long number; /**< Kernel task number */
+    eTaskState state; /**< State when sampled */
+    unsigned long cpu_us; /**< CPU time */
+    float cpu_load; /**< CPU time in percent of the period */
+    unsigned long switches; /**< Times the task was switched in */
+    unsigned long blocks; /**< Times the task blocked */
+    unsigned long max_block_us; /**< Longest time spent blocked */
+    unsigned long total_cpu_ms; /**< CPU time since start */
+} task_stats_t;
+
+/**
+ * @brief Starts sampling the task statistics
+ *
+ * @param period_ms Sampling period in milliseconds
+ * @param csv_path File the samples are appended to, NULL for none
+ * @return 0 on success, -1 otherwise
+ */
+int xTaskStatsStart(unsigned int period_ms, const char *csv_path);
+
+/**
+ * @brief Copies the latest sample, busiest task first
+ *
+ * @param stats Array receiving the statistics
+ * @param max Length of the array
+ * @return Number of tasks copied
+ */
+unsigned int uiTaskStatsGet(task_stats_t *stats, unsigned int max);
+
+/**
+ * @brief Prints the latest sample as CSV lines, without header
+ *
+ * @param fp File to print to
+ */
+void vTaskStatsDump(FILE *fp);
+
+#endif
@@ -1,35 +1,63 @@
 #ifndef __TRACER_H__
 #define __TRACER_H__
-#include <time.h>
-#include <stdio.h>
-
-static FILE *fp_trace = NULL;
-
-void __attribute__((constructor)) trace_begin(void)
-{
-    fp_trace = fopen("trace.out", "w");
-}
-
-void __attribute__((destructor)) trace_end(void)
-{
-    if (fp_trace) {
-        fclose(fp_trace);
-    }
-}
-
-void __attribute((no_instrument_function))
-__cyg_profile_func_enter(void *func, void *caller)
-{
-    if (fp_trace) {
-        fprintf(fp_trace, "e %p %p %lu\n", func, caller, time(NULL));
-    }
-}
-
-void __attribute((no_instrument_function))
-__cyg_profile_func_exit(void *func, void *caller)
-{
-    if (fp_trace) {
-        fprintf(fp_trace, "x %p %p %lu\n", func, caller, time(NULL));
-    }
-}
+#include <stdint.h>
+
+/**
+ * @defgroup tracer Function tracer
+ *
+ * Records every function entry and exit of a -DTRACE_FUNCTIONS build
+ *
+ * The -finstrument-functions hooks append fixed size binary records to a
+ * ring buffer owned by the calling thread, no locks and no formatting on
+ * the hot path. A background thread drains all rings into TRACE_FILE
+ * every TRACE_FLUSH_PERIOD_MS. Events that do not fit into a full ring,
+ * or that arrive from a signal handler interrupting an event of the same
+ * thread, are dropped and counted.
+ *
+ * File layout: one trace_file_header_t, followed by any number of chunks,
+ * each a trace_chunk_header_t followed by count trace_record_t of a single
+ * thread. Addresses are stored relative to TRACE_BASE_SYMBOL so position
+ * independent executables can be symbolized offline, see tools/tracedump.
+ */
+
+#define TRACE_FILE "trace.out"
+#define TRACE_MAGIC "FNTRACE1"
+#define TRACE_BASE_SYMBOL "trace_begin"
+
+/**
+ * Records per thread ring, must be a power of two
+ */
+#define TRACE_RING_SIZE (1 << 16)
+#define TRACE_FLUSH_PERIOD_MS 10
+
+/**
+ * Set in trace_record_t.time for function exits
+ */
+#define TRACE_EXIT_FLAG (1ULL << 63)
+/**
+ * Address offset that does not fit into 32 bits, e.g. a shared library
+ */
+#define TRACE_UNKNOWN_OFFSET INT32_MIN
+
+typedef struct trace_file_header {
+    char magic[8];
+    uint64_t start_ns; /**< CLOCK_MONOTONIC time of the first record */
+} trace_file_header_t;
+
+typedef struct trace_chunk_header {
+    uint32_t tid; /**< Kernel thread id */
+    uint32_t count; /**< Records following */
+    uint32_t dropped; /**< Records dropped since the previous chunk */
+    uint32_t reserved;
+} trace_chunk_header_t;
+
+typedef struct trace_record {
+    uint64_t time; /**< ns since start_ns, TRACE_EXIT_FLAG for exits */
+    int32_t func; /**< Function relative to TRACE_BASE_SYMBOL */
+    int32_t caller; /**< Call site relative to TRACE_BASE_SYMBOL */
+} trace_record_t;
+
+void trace_begin(void);
+void trace_end(void);
+
 #endif
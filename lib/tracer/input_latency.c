@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "TUM_Utils.h"
+#include "input_latency.h"
+
+#if (configUSE_INPUT_LATENCY == 1)
+
+#define NS_IN_US 1000.0
+
+enum {
+    STAGE_QUEUED = 0,
+    STAGE_FRAME,
+    STAGE_PRESENT,
+    STAGE_TOTAL,
+    STAGES
+};
+
+static const char *stage_names[STAGES] = { "queued", "frame", "present",
+                                           "total" };
+
+typedef struct stage_stats {
+    unsigned long count;
+    uint64_t total;
+    uint64_t max;
+    unsigned long hist[INPUT_LATENCY_BUCKETS];
+} stage_stats_t;
+
+typedef struct frame {
+    int64_t start;
+    int64_t submitted;
+    int64_t inputs[INPUT_LATENCY_PER_FRAME];
+    unsigned int count;
+} frame_t;
+
+/**
+ * building is only touched by the frame task, submitted is handed over
+ * to the presenting task in critical sections
+ */
+static struct {
+    frame_t building;
+    frame_t submitted;
+    stage_stats_t stages[STAGES];
+    unsigned long dropped;
+} latency = { 0 };
+
+static unsigned int uiBucket(int64_t ns)
+{
+    uint64_t us = ns > 0 ? ns / 1000 : 0;
+    unsigned int bucket;
+
+    if (!us) {
+        return 0;
+    }
+
+    bucket = 64 - __builtin_clzll(us);
+
+    return bucket < INPUT_LATENCY_BUCKETS ? bucket : INPUT_LATENCY_BUCKETS - 1;
+}
+
+static void vRecord(stage_stats_t *s, int64_t ns)
+{
+    if (ns < 0) {
+        ns = 0;
+    }
+
+    s->count++;
+    s->total += ns;
+    if (ns > s->max) {
+        s->max = ns;
+    }
+    s->hist[uiBucket(ns)]++;
+}
+
+void vInputLatencyFrameStart(void)
+{
+    latency.building.start = tumUtilTimeNs();
+    latency.building.count = 0;
+}
+
+void vInputLatencyEffect(int64_t input_ns)
+{
+    if (latency.building.count == INPUT_LATENCY_PER_FRAME) {
+        latency.dropped++;
+        return;
+    }
+
+    latency.building.inputs[latency.building.count++] = input_ns;
+}
+
+void vInputLatencyFrameSubmitted(void)
+{
+    latency.building.submitted = tumUtilTimeNs();
+
+    taskENTER_CRITICAL();
+    latency.dropped += latency.submitted.count;
+    latency.submitted = latency.building;
+    taskEXIT_CRITICAL();
+
+    latency.building.count = 0;
+}
+
+void vInputLatencyPresented(void)
+{
+    int64_t presented = tumUtilTimeNs();
+    frame_t *f = &latency.submitted;
+    unsigned int i;
+
+    taskENTER_CRITICAL();
+    for (i = 0; i < f->count; i++) {
+        vRecord(&latency.stages[STAGE_QUEUED], f->start - f->inputs[i]);
+        vRecord(&latency.stages[STAGE_FRAME], f->submitted - f->start);
+        vRecord(&latency.stages[STAGE_PRESENT], presented - f->submitted);
+        vRecord(&latency.stages[STAGE_TOTAL], presented - f->inputs[i]);
+    }
+    f->count = 0;
+    taskEXIT_CRITICAL();
+}
+
+unsigned long ulInputLatencySamples(void)
+{
+    return latency.stages[STAGE_TOTAL].count;
+}
+
+/** Upper bound in us of the bucket holding the given percentile */
+static unsigned long ulPercentile(const stage_stats_t *s, double percentile)
+{
+    unsigned long seen = 0;
+    unsigned int i;
+
+    for (i = 0; i < INPUT_LATENCY_BUCKETS; i++) {
+        seen += s->hist[i];
+        if (seen >= s->count * percentile) {
+            break;
+        }
+    }
+
+    return 1UL << (i < INPUT_LATENCY_BUCKETS ? i : INPUT_LATENCY_BUCKETS - 1);
+}
+
+void vInputLatencyReport(FILE *fp)
+{
+    stage_stats_t stages[STAGES];
+    unsigned long dropped;
+    unsigned int i, j;
+
+    taskENTER_CRITICAL();
+    memcpy(stages, latency.stages, sizeof(stages));
+    dropped = latency.dropped;
+    taskEXIT_CRITICAL();
+
+    fprintf(fp, "Input to present latency, %lu inputs\n",
+            stages[STAGE_TOTAL].count);
+    if (!stages[STAGE_TOTAL].count) {
+        return;
+    }
+
+    fprintf(fp, "%-8s %10s %9s %9s %10s\n", "stage", "mean us", "p50<",
+            "p99<", "max us");
+
+    for (i = 0; i < STAGES; i++) {
+        stage_stats_t *s = &stages[i];
+
+        fprintf(fp, "%-8s %10.1f %7luus %7luus %10.1f\n", stage_names[i],
+                s->total / NS_IN_US / s->count, ulPercentile(s, 0.5),
+                ulPercentile(s, 0.99), s->max / NS_IN_US);
+
+        fprintf(fp, "   ");
+        for (j = 0; j < INPUT_LATENCY_BUCKETS; j++) {
+            if (!s->hist[j]) {
+                continue;
+            }
+            if (j == INPUT_LATENCY_BUCKETS - 1) {
+                fprintf(fp, " >=%luus:%lu", 1UL << (j - 1), s->hist[j]);
+            } else {
+                fprintf(fp, " <%luus:%lu", 1UL << j, s->hist[j]);
+            }
+        }
+        fprintf(fp, "\n");
+    }
+
+    if (dropped) {
+        fprintf(fp, "%lu inputs not measured, frame not presented or more "
+                "than %d per frame\n", dropped, INPUT_LATENCY_PER_FRAME);
+    }
+}
+
+#endif
@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "queue.h"
+#include "semphr.h"
+#include "task.h"
+
+// keep the original xSemaphoreTake/Give for the wrappers below
+#define LOCK_PROF_IMPLEMENTATION
+#include "TUM_Utils.h"
+#include "lock_prof.h"
+
+#if (configUSE_LOCK_PROFILE == 1)
+
+#define LOCK_PROF_MASK (LOCK_PROF_MAX_LOCKS - 1)
+#define DELETED_LOCK ((SemaphoreHandle_t)-1)
+
+#define NS_IN_US 1000.0
+
+typedef struct lock_stats {
+    const char *name;
+    unsigned long takes;
+    unsigned long try_fails;
+    unsigned long timeouts;
+    unsigned long holds;
+    uint64_t wait_total;
+    uint64_t wait_max;
+    uint64_t hold_total;
+    uint64_t hold_max;
+    unsigned long wait_hist[LOCK_PROF_BUCKETS];
+    unsigned long hold_hist[LOCK_PROF_BUCKETS];
+} lock_stats_t;
+
+/**
+ * Open addressing table of the live locks, deleted locks leave a
+ * DELETED_LOCK marker so later entries stay reachable
+ */
+typedef struct lock_entry {
+    SemaphoreHandle_t handle;
+    lock_stats_t *stats;
+    uint64_t taken_at;
+    unsigned char is_mutex;
+    unsigned char held;
+} lock_entry_t;
+
+/**
+ * Tasks may be preempted while updating, all tables are only touched in
+ * critical sections
+ */
+static struct {
+    lock_entry_t locks[LOCK_PROF_MAX_LOCKS];
+    lock_stats_t names[LOCK_PROF_MAX_NAMES];
+    unsigned int name_count;
+    unsigned long untracked;
+} prof = { 0 };
+
+static unsigned int uiBucket(uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    unsigned int bucket;
+
+    if (!us) {
+        return 0;
+    }
+
+    bucket = 64 - __builtin_clzll(us);
+
+    return bucket < LOCK_PROF_BUCKETS ? bucket : LOCK_PROF_BUCKETS - 1;
+}
+
+static lock_stats_t *pxFindName(const char *name)
+{
+    unsigned int i;
+
+    for (i = 0; i < prof.name_count; i++) {
+        if (!strcmp(prof.names[i].name, name)) {
+            return &prof.names[i];
+        }
+    }
+
+    if (prof.name_count == LOCK_PROF_MAX_NAMES) {
+        return NULL;
+    }
+
+    prof.names[prof.name_count].name = name;
+    return &prof.names[prof.name_count++];
+}
+
+/**
+ * Looks up a lock, a lock seen for the first time is added if a name is
+ * given
+ */
+static lock_entry_t *pxFindLock(SemaphoreHandle_t lock, const char *name)
+{
+    unsigned int i = ((uintptr_t)lock >> 4) * 2654435761u;
+    lock_entry_t *free_entry = NULL;
+    unsigned int probes;
+
+    for (probes = 0; probes < LOCK_PROF_MAX_LOCKS; probes++, i++) {
+        lock_entry_t *e = &prof.locks[i & LOCK_PROF_MASK];
+
+        if (e->handle == lock) {
+            return e;
+        }
+        if (e->handle == DELETED_LOCK && !free_entry) {
+            free_entry = e;
+        }
+        if (!e->handle) {
+            if (!free_entry) {
+                free_entry = e;
+            }
+            break;
+        }
+    }
+
+    if (!name) {
+        return NULL;
+    }
+
+    if (!free_entry || !(free_entry->stats = pxFindName(name))) {
+        prof.untracked++;
+        return NULL;
+    }
+
+    free_entry->handle = lock;
+    free_entry->is_mutex =
+        ucQueueGetQueueType(lock) == queueQUEUE_TYPE_MUTEX ||
+        ucQueueGetQueueType(lock) == queueQUEUE_TYPE_RECURSIVE_MUTEX;
+    free_entry->held = 0;
+
+    return free_entry;
+}
+
+static void vRecord(uint64_t ns, uint64_t *total, uint64_t *max,
+                    unsigned long *hist)
+{
+    *total += ns;
+    if (ns > *max) {
+        *max = ns;
+    }
+    hist[uiBucket(ns)]++;
+}
+
+BaseType_t xLockProfTake(SemaphoreHandle_t lock, TickType_t block_time,
+                         const char *name)
+{
+    uint64_t start, end;
+    lock_entry_t *e;
+    BaseType_t ret;
+
+    start = tumUtilTimeNs();
+    ret = xSemaphoreTake(lock, block_time);
+    end = tumUtilTimeNs();
+
+    taskENTER_CRITICAL();
+    e = pxFindLock(lock, name);
+    if (e) {
+        if (ret == pdTRUE) {
+            e->stats->takes++;
+            if (e->is_mutex) {
+                e->taken_at = end;
+                e->held = 1;
+            }
+        } else if (block_time == 0) {
+            e->stats->try_fails++;
+        } else {
+            e->stats->timeouts++;
+        }
+
+        if (block_time) {
+            vRecord(end - start, &e->stats->wait_total, &e->stats->wait_max,
+                    e->stats->wait_hist);
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return ret;
+}
+
+BaseType_t xLockProfGive(SemaphoreHandle_t lock)
+{
+    lock_entry_t *e;
+
+    taskENTER_CRITICAL();
+    e = pxFindLock(lock, NULL);
+    if (e && e->held) {
+        e->held = 0;
+        e->stats->holds++;
+        vRecord(tumUtilTimeNs() - e->taken_at, &e->stats->hold_total,
+                &e->stats->hold_max, e->stats->hold_hist);
+    }
+    taskEXIT_CRITICAL();
+
+    return xSemaphoreGive(lock);
+}
+
+void vLockProfDelete(SemaphoreHandle_t lock)
+{
+    lock_entry_t *e;
+
+    taskENTER_CRITICAL();
+    e = pxFindLock(lock, NULL);
+    if (e) {
+        e->handle = DELETED_LOCK;
+    }
+    taskEXIT_CRITICAL();
+
+    vSemaphoreDelete(lock);
+}
+
+static int xCompareWait(const void *a, const void *b)
+{
+    const lock_stats_t *x = a, *y = b;
+
+    return (x->wait_total < y->wait_total) - (x->wait_total > y->wait_total);
+}
+
+/** Upper bound in us of the bucket holding the given percentile */
+static unsigned long ulPercentile(const unsigned long *hist,
+                                  unsigned long count, double percentile)
+{
+    unsigned long seen = 0;
+    unsigned int i;
+
+    for (i = 0; i < LOCK_PROF_BUCKETS; i++) {
+        seen += hist[i];
+        if (seen >= count * percentile) {
+            break;
+        }
+    }
+
+    return 1UL << (i < LOCK_PROF_BUCKETS ? i : LOCK_PROF_BUCKETS - 1);
+}
+
+static void vPrintHistogram(FILE *fp, const char *label,
+                            const unsigned long *hist)
+{
+    unsigned int i;
+
+    fprintf(fp, "    %s", label);
+    for (i = 0; i < LOCK_PROF_BUCKETS; i++) {
+        if (!hist[i]) {
+            continue;
+        }
+        if (i == LOCK_PROF_BUCKETS - 1) {
+            fprintf(fp, " >=%luus:%lu", 1UL << (i - 1), hist[i]);
+        } else {
+            fprintf(fp, " <%luus:%lu", 1UL << i, hist[i]);
+        }
+    }
+    fprintf(fp, "\n");
+}
+
+void vLockProfReport(FILE *fp)
+{
+    lock_stats_t names[LOCK_PROF_MAX_NAMES];
+    unsigned long untracked, waits;
+    unsigned int count, i, j;
+
+    taskENTER_CRITICAL();
+    memcpy(names, prof.names, sizeof(names));
+    count = prof.name_count;
+    untracked = prof.untracked;
+    taskEXIT_CRITICAL();
+
+    qsort(names, count, sizeof(lock_stats_t), xCompareWait);
+
+    fprintf(fp, "Lock profile, most total wait first\n");
+    fprintf(fp, "%-28s %8s %8s %7s %10s %9s %9s %9s %9s\n", "lock",
+            "takes", "tryfail", "timeout", "wait ms", "wait p99<",
+            "max us", "hold p99<", "max us");
+
+    for (i = 0; i < count; i++) {
+        lock_stats_t *s = &names[i];
+
+        fprintf(fp, "%-28.28s %8lu %8lu %7lu %10.3f ", s->name, s->takes,
+                s->try_fails, s->timeouts, s->wait_total / NS_IN_US / 1000);
+
+        // try-takes do not wait and are not in the wait histogram
+        waits = 0;
+        for (j = 0; j < LOCK_PROF_BUCKETS; j++) {
+            waits += s->wait_hist[j];
+        }
+        if (waits) {
+            fprintf(fp, "%7luus %9.1f ", ulPercentile(s->wait_hist, waits,
+                    0.99), s->wait_max / NS_IN_US);
+        } else {
+            fprintf(fp, "%9s %9s ", "-", "-");
+        }
+        if (s->holds) {
+            fprintf(fp, "%7luus %9.1f\n",
+                    ulPercentile(s->hold_hist, s->holds, 0.99),
+                    s->hold_max / NS_IN_US);
+        } else {
+            fprintf(fp, "%9s %9s\n", "-", "-");
+        }
+
+        if (waits) {
+            vPrintHistogram(fp, "wait", s->wait_hist);
+        }
+        if (s->holds) {
+            vPrintHistogram(fp, "hold", s->hold_hist);
+        }
+    }
+
+    if (untracked) {
+        fprintf(fp, "%lu takes of locks beyond the table size not profiled\n",
+                untracked);
+    }
+}
+
+#endif
@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "TUM_Utils.h"
+#include "prof_zone.h"
+
+#if (configUSE_PROF_ZONES == 1)
+
+#define NS_IN_MS 1000000ULL
+#define NS_IN_US 1000.0
+
+typedef struct zone_totals {
+    unsigned long calls;
+    uint64_t ns;
+    uint64_t max_ns; /**< longest frame */
+} zone_totals_t;
+
+typedef struct zone {
+    const char *name;
+    unsigned long calls; /**< current frame */
+    uint64_t ns;
+    zone_totals_t period;
+    zone_totals_t all;
+} zone_t;
+
+/**
+ * Zones and frames are only touched by the frame task, the summary of the
+ * last period is copied in critical sections. The frame task writes the
+ * CSV file outside of them, only taking the file pointer and marking it
+ * as written in a critical section, so the exit handler, which may run on
+ * any task, never closes the file under it.
+ */
+static struct {
+    int active;
+    FILE *csv;
+    int writing;
+    unsigned int count;
+    zone_t zones[PROF_MAX_ZONES];
+    unsigned long frames;
+    unsigned long period_frames;
+    uint64_t period_start;
+    prof_zone_stats_t last[PROF_MAX_ZONES];
+    unsigned int last_count;
+} prof = { 0 };
+
+prof_scope_t xProfScopeEnter(prof_zone_t *zone)
+{
+    prof_scope_t scope = { 0 };
+
+    if (!prof.active) {
+        return scope;
+    }
+
+    if (zone->id < 0) {
+        if (prof.count == PROF_MAX_ZONES) {
+            return scope;
+        }
+        zone->id = prof.count;
+        prof.zones[prof.count++].name = zone->name;
+    }
+
+    scope.zone = zone;
+    scope.start = tumUtilTimeNs();
+
+    return scope;
+}
+
+void vProfScopeExit(prof_scope_t *scope)
+{
+    zone_t *zone;
+
+    if (!scope->zone) {
+        return;
+    }
+
+    zone = &prof.zones[scope->zone->id];
+    zone->calls++;
+    zone->ns += tumUtilTimeNs() - scope->start;
+}
+
+static void vAddFrame(zone_totals_t *totals, const zone_t *zone)
+{
+    totals->calls += zone->calls;
+    totals->ns += zone->ns;
+    if (zone->ns > totals->max_ns) {
+        totals->max_ns = zone->ns;
+    }
+}
+
+static void vSummarize(const zone_totals_t *totals, unsigned long frames,
+                       prof_zone_stats_t *stats)
+{
+    stats->calls = (float)totals->calls / frames;
+    stats->mean_us = totals->ns / NS_IN_US / frames;
+    stats->max_us = totals->max_ns / NS_IN_US;
+}
+
+void vProfFrameEnd(void)
+{
+    uint64_t now;
+    unsigned int i;
+    zone_t *zone;
+    FILE *csv;
+    int orphaned;
+
+    if (!prof.active) {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    csv = prof.csv;
+    prof.writing = csv != NULL;
+    taskEXIT_CRITICAL();
+
+    if (csv) {
+        for (i = 0; i < prof.count; i++) {
+            if (prof.zones[i].calls) {
+                fprintf(csv, "%lu,%s,%lu,%llu\n", prof.frames,
+                        prof.zones[i].name, prof.zones[i].calls,
+                        (unsigned long long)prof.zones[i].ns);
+            }
+        }
+
+        taskENTER_CRITICAL();
+        prof.writing = 0;
+        orphaned = !prof.csv;
+        taskEXIT_CRITICAL();
+
+        // the exit handler left closing to us
+        if (orphaned) {
+            fclose(csv);
+        }
+    }
+
+    for (i = 0; i < prof.count; i++) {
+        zone = &prof.zones[i];
+        vAddFrame(&zone->period, zone);
+        vAddFrame(&zone->all, zone);
+        zone->calls = 0;
+        zone->ns = 0;
+    }
+    prof.frames++;
+    prof.period_frames++;
+
+    now = tumUtilTimeNs();
+    if (now - prof.period_start < PROF_PERIOD_MS * NS_IN_MS) {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    for (i = 0; i < prof.count; i++) {
+        zone = &prof.zones[i];
+        prof.last[i].name = zone->name;
+        vSummarize(&zone->period, prof.period_frames, &prof.last[i]);
+        memset(&zone->period, 0, sizeof(zone->period));
+    }
+    prof.last_count = prof.count;
+    taskEXIT_CRITICAL();
+
+    prof.period_frames = 0;
+    prof.period_start = now;
+}
+
+unsigned int uiProfZonesGet(prof_zone_stats_t *stats, unsigned int max)
+{
+    unsigned int count;
+
+    taskENTER_CRITICAL();
+    count = prof.last_count < max ? prof.last_count : max;
+    memcpy(stats, prof.last, count * sizeof(prof_zone_stats_t));
+    taskEXIT_CRITICAL();
+
+    return count;
+}
+
+void vProfZonesReport(FILE *fp)
+{
+    prof_zone_stats_t stats;
+
+    fprintf(fp, "Profiling zones per frame, %lu frames\n", prof.frames);
+    if (!prof.frames) {
+        return;
+    }
+
+    fprintf(fp, "%-12s %9s %9s %9s\n", "zone", "calls", "mean us", "max us");
+    for (unsigned int i = 0; i < prof.count; i++) {
+        vSummarize(&prof.zones[i].all, prof.frames, &stats);
+        fprintf(fp, "%-12s %9.1f %9.1f %9.1f\n", prof.zones[i].name,
+                stats.calls, stats.mean_us, stats.max_us);
+    }
+}
+
+static void vProfZonesExit(void)
+{
+    FILE *csv;
+    int writing;
+
+    taskENTER_CRITICAL();
+    prof.active = 0;
+    csv = prof.csv;
+    prof.csv = NULL;
+    writing = prof.writing;
+    taskEXIT_CRITICAL();
+
+    // a frame being written closes the file once done, if the process
+    // exits first, exit() flushes it
+    if (csv && !writing) {
+        fclose(csv);
+    }
+}
+
+int xProfZonesStart(const char *csv_path)
+{
+    if (csv_path) {
+        prof.csv = fopen(csv_path, "w");
+        if (!prof.csv) {
+            perror("prof_zone");
+            return -1;
+        }
+        fprintf(prof.csv, "frame,zone,calls,ns\n");
+    }
+
+    if (atexit(vProfZonesExit)) {
+        return -1;
+    }
+
+    prof.period_start = tumUtilTimeNs();
+    prof.active = 1;
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "FreeRTOS.h"
+#include "queue.h"
+
+#if (configUSE_SCHED_TRACE == 1)
+
+#include "TUM_Utils.h"
+#include "sched_trace.h"
+
+#define SCHED_TRACE_MASK (SCHED_TRACE_EVENTS - 1)
+
+// kernel task numbers start at 1, tid 0 collects events from before the
+// scheduler started
+#define SCHED_TRACE_MAX_TASKS 64
+#define TICKS_TID SCHED_TRACE_MAX_TASKS
+#define MAX_MUTEXES 64
+
+#define NS_IN_US 1000.0
+
+typedef struct sched_event {
+    uint64_t time;
+    void *object;
+    unsigned long arg;
+    unsigned int seq;
+    unsigned char type;
+    unsigned char queue_type;
+    unsigned short task;
+} sched_event_t;
+
+/**
+ * Any thread may record, including the SIGIO handler, so slots are
+ * claimed by an atomic increment. A slot is valid once its seq has been
+ * set to the claimed index + 1 with release semantics.
+ */
+static struct {
+    sched_event_t events[SCHED_TRACE_EVENTS];
+    unsigned int next;
+    int active;
+    uint64_t start;
+    unsigned short current_task;
+    char names[SCHED_TRACE_MAX_TASKS][configMAX_TASK_NAME_LEN];
+    const char *path;
+} trace = { 0 };
+
+static void vSchedTraceRecord(unsigned char type, unsigned short task,
+                              void *object, unsigned char queue_type,
+                              unsigned long arg)
+{
+    sched_event_t *e;
+    unsigned int slot;
+
+    if (!__atomic_load_n(&trace.active, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    slot = __atomic_fetch_add(&trace.next, 1, __ATOMIC_RELAXED);
+    e = &trace.events[slot & SCHED_TRACE_MASK];
+
+    __atomic_store_n(&e->seq, 0, __ATOMIC_RELAXED);
+    e->time = tumUtilTimeNs() - trace.start;
+    e->object = object;
+    e->arg = arg;
+    e->type = type;
+    e->queue_type = queue_type;
+    e->task = task;
+    __atomic_store_n(&e->seq, slot + 1, __ATOMIC_RELEASE);
+}
+
+void vSchedTraceSwitchedIn(unsigned long ulTaskNumber, const char *pcName)
+{
+    if (ulTaskNumber >= SCHED_TRACE_MAX_TASKS) {
+        ulTaskNumber = 0;
+    } else if (!trace.names[ulTaskNumber][0]) {
+        strncpy(trace.names[ulTaskNumber], pcName,
+                configMAX_TASK_NAME_LEN - 1);
+    }
+
+    trace.current_task = ulTaskNumber;
+
+    vSchedTraceRecord(SCHED_EVENT_SWITCHED_IN, ulTaskNumber, NULL, 0, 0);
+}
+
+void vSchedTraceSwitchedOut(unsigned long ulTaskNumber)
+{
+    if (ulTaskNumber >= SCHED_TRACE_MAX_TASKS) {
+        ulTaskNumber = 0;
+    }
+
+    vSchedTraceRecord(SCHED_EVENT_SWITCHED_OUT, ulTaskNumber, NULL, 0, 0);
+}
+
+void vSchedTraceTick(unsigned long ulTickCount)
+{
+    vSchedTraceRecord(SCHED_EVENT_TICK, TICKS_TID, NULL, 0, ulTickCount);
+}
+
+void vSchedTraceQueue(int iEvent, void *pvQueue, unsigned char ucQueueType)
+{
+    vSchedTraceRecord(iEvent, trace.current_task, pvQueue, ucQueueType, 0);
+}
+
+static int xIsMutex(unsigned char queue_type)
+{
+    return queue_type == queueQUEUE_TYPE_MUTEX ||
+           queue_type == queueQUEUE_TYPE_RECURSIVE_MUTEX;
+}
+
+static const char *pcOperation(const sched_event_t *e)
+{
+    int semaphore = e->queue_type != queueQUEUE_TYPE_BASE;
+
+    switch (e->type) {
+        case SCHED_EVENT_SEND:
+            return semaphore ? "give" : "send";
+        case SCHED_EVENT_SEND_FAILED:
+            return semaphore ? "give failed" : "send failed";
+        case SCHED_EVENT_BLOCK_ON_SEND:
+            return "block on";
+        case SCHED_EVENT_RECEIVE:
+            return semaphore ? "take" : "receive";
+        case SCHED_EVENT_RECEIVE_FAILED:
+            return semaphore ? "take failed" : "receive failed";
+        case SCHED_EVENT_BLOCK_ON_RECEIVE:
+            return "block on";
+        case SCHED_EVENT_SEND_FROM_ISR:
+            return semaphore ? "give from ISR" : "send from ISR";
+        case SCHED_EVENT_RECEIVE_FROM_ISR:
+            return semaphore ? "take from ISR" : "receive from ISR";
+        default:
+            return "?";
+    }
+}
+
+static void vObjectName(void *object, char *name, size_t len)
+{
+    const char *registered = pcQueueGetName(object);
+
+    if (registered) {
+        snprintf(name, len, "%s", registered);
+    } else {
+        snprintf(name, len, "%p", object);
+    }
+}
+
+/**
+ * Mutex holds are async slices, an end is only emitted for a hold whose
+ * begin is still in the ring
+ */
+static int xToggleHold(void **held, void *mutex, int take)
+{
+    int i, free_slot = -1;
+
+    for (i = 0; i < MAX_MUTEXES; i++) {
+        if (held[i] == mutex) {
+            if (!take) {
+                held[i] = NULL;
+            }
+            return !take;
+        }
+        if (!held[i] && free_slot < 0) {
+            free_slot = i;
+        }
+    }
+
+    if (take && free_slot >= 0) {
+        held[free_slot] = mutex;
+        return 1;
+    }
+
+    return 0;
+}
+
+static void vExportEvent(FILE *fp, const sched_event_t *e,
+                         unsigned char *running, void **held)
+{
+    double ts = e->time / NS_IN_US;
+    char name[configMAX_TASK_NAME_LEN + 16];
+
+    switch (e->type) {
+        case SCHED_EVENT_SWITCHED_IN:
+            running[e->task] = 1;
+            fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"B\",\"pid\":1,"
+                    "\"tid\":%u,\"ts\":%.3f}", trace.names[e->task],
+                    e->task, ts);
+            return;
+        case SCHED_EVENT_SWITCHED_OUT:
+            if (running[e->task]) {
+                running[e->task] = 0;
+                fprintf(fp, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%u,"
+                        "\"ts\":%.3f}", e->task, ts);
+            }
+            return;
+        case SCHED_EVENT_TICK:
+            fprintf(fp, ",\n{\"name\":\"tick\",\"ph\":\"i\",\"s\":\"t\","
+                    "\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+                    "\"args\":{\"count\":%lu}}", e->task, ts, e->arg);
+            return;
+        default:
+            break;
+    }
+
+    vObjectName(e->object, name, sizeof(name));
+
+    fprintf(fp, ",\n{\"name\":\"%s %s\",\"ph\":\"i\",\"s\":\"t\","
+            "\"pid\":1,\"tid\":%u,\"ts\":%.3f}", pcOperation(e), name,
+            e->task, ts);
+
+    if (xIsMutex(e->queue_type) &&
+        (e->type == SCHED_EVENT_RECEIVE || e->type == SCHED_EVENT_SEND) &&
+        xToggleHold(held, e->object, e->type == SCHED_EVENT_RECEIVE)) {
+        fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"mutex\",\"ph\":\"%c\","
+                "\"id\":\"%p\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}", name,
+                e->type == SCHED_EVENT_RECEIVE ? 'b' : 'e', e->object,
+                e->task, ts);
+    }
+}
+
+int xSchedTraceExport(const char *path)
+{
+    unsigned char running[SCHED_TRACE_MAX_TASKS + 1] = { 0 };
+    void *held[MAX_MUTEXES] = { NULL };
+    unsigned int end, i, skipped = 0;
+    sched_event_t e;
+    FILE *fp;
+
+    fp = fopen(path, "w");
+    if (!fp) {
+        perror("sched trace");
+        return -1;
+    }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"args\":{\"name\":\"FreeRTOS\"}}");
+    fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"tid\":0,\"args\":{\"name\":\"main\"}}");
+    fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"tid\":%d,\"args\":{\"name\":\"Ticks\"}}", TICKS_TID);
+    for (i = 1; i < SCHED_TRACE_MAX_TASKS; i++) {
+        if (trace.names[i][0]) {
+            fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\","
+                    "\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", i,
+                    trace.names[i]);
+        }
+    }
+
+    end = __atomic_load_n(&trace.next, __ATOMIC_ACQUIRE);
+    i = (end > SCHED_TRACE_EVENTS) ? end - SCHED_TRACE_EVENTS : 0;
+
+    for (; i != end; i++) {
+        sched_event_t *slot = &trace.events[i & SCHED_TRACE_MASK];
+
+        // skip slots that are still being written or already reused
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != i + 1) {
+            skipped++;
+            continue;
+        }
+        memcpy(&e, slot, sizeof(e));
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != i + 1) {
+            skipped++;
+            continue;
+        }
+
+        vExportEvent(fp, &e, running, held);
+    }
+
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+
+    if (skipped) {
+        fprintf(stderr, "[WARNING] sched trace: %u events overwritten "
+                "while exporting\n", skipped);
+    }
+
+    return 0;
+}
+
+static void vSchedTraceExit(void)
+{
+    __atomic_store_n(&trace.active, 0, __ATOMIC_RELEASE);
+
+    if (!xSchedTraceExport(trace.path)) {
+        printf("Scheduler trace written to %s\n", trace.path);
+    }
+}
+
+int xSchedTraceStart(const char *path)
+{
+    trace.path = path;
+    trace.start = tumUtilTimeNs();
+
+    if (atexit(vSchedTraceExit)) {
+        return -1;
+    }
+
+    __atomic_store_n(&trace.active, 1, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,243 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+#if (configUSE_TASK_STATS == 1)
+
+#include "task_stats.h"
+
+#define TASK_STATS_PRIORITY (tskIDLE_PRIORITY + 1)
+#define TASK_STATS_STACK_SIZE ((unsigned short)1024)
+
+/**
+ * Written by the switch hooks, which run inside vTaskSwitchContext() with
+ * the kernel locked, and read by the sampling task in a critical section.
+ * Indexed by the kernel task number, which is never reused.
+ */
+static struct {
+    unsigned long switches;
+    unsigned long blocks;
+    uint32_t max_block_us;
+    uint32_t blocked_since;
+    unsigned char blocked;
+
+    // only used by the sampling task
+    uint32_t last_run_time;
+} counters[TASK_STATS_MAX_TASKS] = { 0 };
+
+static struct {
+    SemaphoreHandle_t lock;
+    task_stats_t tasks[TASK_STATS_MAX_TASKS];
+    unsigned int count;
+    unsigned long time_ms;
+
+    TickType_t period;
+    FILE *csv;
+    uint32_t last_total;
+} sample = { 0 };
+
+static const char *state_names[] = {
+    [eRunning] = "running",
+    [eReady] = "ready",
+    [eBlocked] = "blocked",
+    [eSuspended] = "suspended",
+    [eDeleted] = "deleted",
+    [eInvalid] = "invalid",
+};
+
+void vTaskStatsSwitchedIn(unsigned long ulTaskNumber)
+{
+    uint32_t blocked_for;
+
+    if (ulTaskNumber >= TASK_STATS_MAX_TASKS) {
+        return;
+    }
+
+    counters[ulTaskNumber].switches++;
+
+    if (counters[ulTaskNumber].blocked) {
+        blocked_for = portGET_RUN_TIME_COUNTER_VALUE() -
+                      counters[ulTaskNumber].blocked_since;
+        if (blocked_for > counters[ulTaskNumber].max_block_us) {
+            counters[ulTaskNumber].max_block_us = blocked_for;
+        }
+        counters[ulTaskNumber].blocked = 0;
+    }
+}
+
+void vTaskStatsSwitchedOut(unsigned long ulTaskNumber, int iReason)
+{
+    if (ulTaskNumber >= TASK_STATS_MAX_TASKS) {
+        return;
+    }
+
+    // time spent suspended is not blocking on anything
+    if (iReason == TASK_STATS_BLOCKED) {
+        counters[ulTaskNumber].blocks++;
+        counters[ulTaskNumber].blocked_since =
+            portGET_RUN_TIME_COUNTER_VALUE();
+        counters[ulTaskNumber].blocked = 1;
+    }
+}
+
+static int xCompareLoad(const void *a, const void *b)
+{
+    const task_stats_t *x = a, *y = b;
+
+    if (x->cpu_us == y->cpu_us) {
+        return (x->number > y->number) - (x->number < y->number);
+    }
+
+    return (x->cpu_us < y->cpu_us) ? 1 : -1;
+}
+
+static void vTaskStatsSample(void)
+{
+    TaskStatus_t status[TASK_STATS_MAX_TASKS];
+    task_stats_t tasks[TASK_STATS_MAX_TASKS];
+    unsigned long switches[TASK_STATS_MAX_TASKS];
+    unsigned long blocks[TASK_STATS_MAX_TASKS];
+    uint32_t max_block_us[TASK_STATS_MAX_TASKS];
+    uint32_t total, period_us;
+    unsigned int count, i, n = 0;
+    unsigned long number;
+
+    count = uxTaskGetSystemState(status, TASK_STATS_MAX_TASKS, &total);
+
+    taskENTER_CRITICAL();
+    for (i = 0; i < TASK_STATS_MAX_TASKS; i++) {
+        switches[i] = counters[i].switches;
+        blocks[i] = counters[i].blocks;
+        max_block_us[i] = counters[i].max_block_us;
+        counters[i].switches = 0;
+        counters[i].blocks = 0;
+        counters[i].max_block_us = 0;
+    }
+    taskEXIT_CRITICAL();
+
+    period_us = total - sample.last_total;
+    sample.last_total = total;
+
+    for (i = 0; i < count; i++) {
+        number = status[i].xTaskNumber;
+        if (number >= TASK_STATS_MAX_TASKS) {
+            continue;
+        }
+
+        strncpy(tasks[n].name, status[i].pcTaskName,
+                configMAX_TASK_NAME_LEN - 1);
+        tasks[n].name[configMAX_TASK_NAME_LEN - 1] = '\0';
+        tasks[n].number = number;
+        tasks[n].state = status[i].eCurrentState;
+        tasks[n].cpu_us =
+            status[i].ulRunTimeCounter - counters[number].last_run_time;
+        tasks[n].cpu_load =
+            period_us ? tasks[n].cpu_us * 100.0f / period_us : 0;
+        tasks[n].switches = switches[number];
+        tasks[n].blocks = blocks[number];
+        tasks[n].max_block_us = max_block_us[number];
+        tasks[n].total_cpu_ms = status[i].ulRunTimeCounter / 1000;
+
+        counters[number].last_run_time = status[i].ulRunTimeCounter;
+        n++;
+    }
+
+    qsort(tasks, n, sizeof(task_stats_t), xCompareLoad);
+
+    xSemaphoreTake(sample.lock, portMAX_DELAY);
+    memcpy(sample.tasks, tasks, n * sizeof(task_stats_t));
+    sample.count = n;
+    sample.time_ms = total / 1000;
+    xSemaphoreGive(sample.lock);
+}
+
+static void vTaskStatsTask(void *pvParameters)
+{
+    TickType_t last_wake = xTaskGetTickCount();
+
+    while (1) {
+        vTaskDelayUntil(&last_wake, sample.period);
+
+        vTaskStatsSample();
+
+        if (sample.csv) {
+            vTaskStatsDump(sample.csv);
+            fflush(sample.csv);
+        }
+    }
+}
+
+int xTaskStatsStart(unsigned int period_ms, const char *csv_path)
+{
+    sample.lock = xSemaphoreCreateMutex();
+    if (!sample.lock) {
+        return -1;
+    }
+
+    sample.period = pdMS_TO_TICKS(period_ms);
+
+    if (csv_path) {
+        sample.csv = fopen(csv_path, "w");
+        if (!sample.csv) {
+            perror("task stats");
+        } else {
+            fprintf(sample.csv, "time_ms,task,state,cpu_us,cpu_pct,switches,"
+                    "blocks,max_block_us,total_cpu_ms\n");
+        }
+    }
+
+    if (xTaskCreate(vTaskStatsTask, "TaskStats", TASK_STATS_STACK_SIZE, NULL,
+                    TASK_STATS_PRIORITY, NULL) != pdPASS) {
+        if (sample.csv) {
+            fclose(sample.csv);
+            sample.csv = NULL;
+        }
+        vSemaphoreDelete(sample.lock);
+        sample.lock = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+unsigned int uiTaskStatsGet(task_stats_t *stats, unsigned int max)
+{
+    unsigned int n;
+
+    if (!sample.lock) {
+        return 0;
+    }
+
+    xSemaphoreTake(sample.lock, portMAX_DELAY);
+    n = (sample.count < max) ? sample.count : max;
+    memcpy(stats, sample.tasks, n * sizeof(task_stats_t));
+    xSemaphoreGive(sample.lock);
+
+    return n;
+}
+
+void vTaskStatsDump(FILE *fp)
+{
+    unsigned int i;
+
+    if (!sample.lock) {
+        return;
+    }
+
+    xSemaphoreTake(sample.lock, portMAX_DELAY);
+    for (i = 0; i < sample.count; i++) {
+        fprintf(fp, "%lu,%s,%s,%lu,%.1f,%lu,%lu,%lu,%lu\n",
+                sample.time_ms, sample.tasks[i].name,
+                state_names[sample.tasks[i].state], sample.tasks[i].cpu_us,
+                sample.tasks[i].cpu_load, sample.tasks[i].switches,
+                sample.tasks[i].blocks, sample.tasks[i].max_block_us,
+                sample.tasks[i].total_cpu_ms);
+    }
+    xSemaphoreGive(sample.lock);
+}
+
+#endif
@@ -0,0 +1,232 @@
+#ifdef TRACE_FUNCTIONS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "TUM_Utils.h"
+#include "tracer.h"
+
+#define NO_TRACE __attribute__((no_instrument_function))
+
+#define TRACE_RING_MASK (TRACE_RING_SIZE - 1)
+
+#define NS_IN_MS 1000000L
+
+/**
+ * head is only written by the owning thread, tail only by the flusher.
+ * A record is published by the release store of head and handed back
+ * by the release store of tail.
+ */
+typedef struct trace_ring {
+    trace_record_t records[TRACE_RING_SIZE];
+    unsigned int head;
+    unsigned int tail;
+    unsigned int dropped;
+    unsigned int reported_dropped;
+    uint32_t tid;
+    struct trace_ring *next;
+} trace_ring_t;
+
+static __thread trace_ring_t *ring = NULL;
+// set while the thread records, events of interrupting signal handlers
+// are dropped instead of racing for the same slot
+static __thread int recording = 0;
+
+static struct {
+    FILE *fp;
+    uint64_t start_ns;
+    uintptr_t base;
+    int active;
+    int stop;
+    pthread_t flusher;
+    trace_ring_t *rings;
+} tracer = { 0 };
+
+static NO_TRACE int32_t xTraceOffset(void *addr)
+{
+    intptr_t offset = (intptr_t)addr - (intptr_t)tracer.base;
+
+    if (offset <= INT32_MIN || offset > INT32_MAX) {
+        return TRACE_UNKNOWN_OFFSET;
+    }
+
+    return offset;
+}
+
+static NO_TRACE trace_ring_t *xTraceNewRing(void)
+{
+    trace_ring_t *new_ring = calloc(1, sizeof(trace_ring_t));
+
+    if (!new_ring) {
+        return NULL;
+    }
+
+    new_ring->tid = syscall(SYS_gettid);
+
+    // rings are never freed, the flusher may still drain exited threads
+    new_ring->next = __atomic_load_n(&tracer.rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&tracer.rings, &new_ring->next,
+                                        new_ring, 0, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED))
+        ;
+
+    return new_ring;
+}
+
+static NO_TRACE void vTraceRecord(void *func, void *caller, uint64_t flag)
+{
+    trace_record_t *record;
+    unsigned int head;
+
+    if (!__atomic_load_n(&tracer.active, __ATOMIC_RELAXED) || recording) {
+        if (ring) {
+            ring->dropped++;
+        }
+        return;
+    }
+    recording = 1;
+
+    if (!ring) {
+        ring = xTraceNewRing();
+        if (!ring) {
+            goto out;
+        }
+    }
+
+    head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) ==
+        TRACE_RING_SIZE) {
+        ring->dropped++;
+        goto out;
+    }
+
+    record = &ring->records[head & TRACE_RING_MASK];
+    record->time = (tumUtilTimeNs() - tracer.start_ns) | flag;
+    record->func = xTraceOffset(func);
+    record->caller = xTraceOffset(caller);
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+out:
+    recording = 0;
+}
+
+static NO_TRACE void vTraceFlushRing(trace_ring_t *r)
+{
+    trace_chunk_header_t chunk = { 0 };
+    unsigned int head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    unsigned int tail = r->tail;
+    unsigned int dropped = __atomic_load_n(&r->dropped, __ATOMIC_RELAXED);
+    unsigned int first;
+
+    if (head == tail && dropped == r->reported_dropped) {
+        return;
+    }
+
+    chunk.tid = r->tid;
+    chunk.count = head - tail;
+    chunk.dropped = dropped - r->reported_dropped;
+    r->reported_dropped = dropped;
+    fwrite(&chunk, sizeof(chunk), 1, tracer.fp);
+
+    // the pending records may wrap around the end of the ring
+    first = TRACE_RING_SIZE - (tail & TRACE_RING_MASK);
+    if (first > chunk.count) {
+        first = chunk.count;
+    }
+    fwrite(&r->records[tail & TRACE_RING_MASK], sizeof(trace_record_t),
+           first, tracer.fp);
+    fwrite(&r->records[0], sizeof(trace_record_t), chunk.count - first,
+           tracer.fp);
+
+    __atomic_store_n(&r->tail, head, __ATOMIC_RELEASE);
+}
+
+static NO_TRACE void vTraceFlushAll(void)
+{
+    trace_ring_t *r;
+
+    for (r = __atomic_load_n(&tracer.rings, __ATOMIC_ACQUIRE); r;
+         r = r->next) {
+        vTraceFlushRing(r);
+    }
+}
+
+static NO_TRACE void *vTraceFlusher(void *args)
+{
+    struct timespec period = { 0, TRACE_FLUSH_PERIOD_MS * NS_IN_MS };
+
+    while (!__atomic_load_n(&tracer.stop, __ATOMIC_ACQUIRE)) {
+        nanosleep(&period, NULL);
+        vTraceFlushAll();
+    }
+
+    return NULL;
+}
+
+void __attribute__((constructor)) NO_TRACE trace_begin(void)
+{
+    trace_file_header_t header = { TRACE_MAGIC };
+    sigset_t all_signals, old_signals;
+    int ret;
+
+    tracer.fp = fopen(TRACE_FILE, "wb");
+    if (!tracer.fp) {
+        perror("tracer");
+        return;
+    }
+
+    tracer.base = (uintptr_t)trace_begin;
+    tracer.start_ns = tumUtilTimeNs();
+    header.start_ns = tracer.start_ns;
+    fwrite(&header, sizeof(header), 1, tracer.fp);
+
+    // the flusher must never be picked to run the tick, SIGIO or RTOS
+    // handlers
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_BLOCK, &all_signals, &old_signals);
+    ret = pthread_create(&tracer.flusher, NULL, vTraceFlusher, NULL);
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+
+    if (ret) {
+        perror("tracer");
+        fclose(tracer.fp);
+        tracer.fp = NULL;
+        return;
+    }
+
+    __atomic_store_n(&tracer.active, 1, __ATOMIC_RELEASE);
+}
+
+void __attribute__((destructor)) NO_TRACE trace_end(void)
+{
+    if (!tracer.fp) {
+        return;
+    }
+
+    __atomic_store_n(&tracer.active, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&tracer.stop, 1, __ATOMIC_RELEASE);
+    pthread_join(tracer.flusher, NULL);
+
+    vTraceFlushAll();
+    fclose(tracer.fp);
+    tracer.fp = NULL;
+}
+
+void NO_TRACE __cyg_profile_func_enter(void *func, void *caller)
+{
+    vTraceRecord(func, caller, 0);
+}
+
+void NO_TRACE __cyg_profile_func_exit(void *func, void *caller)
+{
+    vTraceRecord(func, caller, TRACE_EXIT_FLAG);
+}
+
+#endif
@@ -1,10 +1,12 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <inttypes.h>
 
 #include <SDL2/SDL_scancode.h>
+#include <SDL2/SDL_mouse.h>
 
 #include "FreeRTOS.h"
 #include "queue.h"
@@ -20,10 +22,20 @@
 #include "TUM_Font.h"
 
 #include "AsyncIO.h"
+#include "ai_link.h"
+#include "task_stats.h"
+#include "sched_trace.h"
+#include "lock_prof.h"
+#include "input_latency.h"
+#include "frame_timing.h"
+#include "prof_zone.h"
 
 #include "play_graphics.h"
 #include "menu_graphics.h"
 #include "play_dynamics.h"
+#include "screen_manager.h"
+#include "replay.h"
+#include "frame_pacer.h"
 
 #define mainGENERIC_PRIORITY (tskIDLE_PRIORITY)
 #define mainGENERIC_STACK_SIZE ((unsigned short)2560)
@@ -37,27 +49,21 @@
 #define UDP_RECEIVE_PORT 1234
 #define UDP_TRANSMIT_PORT 1235
 
+#define FRAME_CAP_FPS 60
+#define INPUT_PUMP_PERIOD 2 // ms between two polls of SDL events
+
 aIO_handle_t udp_soc_one = NULL;
 aIO_handle_t udp_soc_two = NULL;
 
-static TaskHandle_t startscreen_task = NULL;
-static TaskHandle_t playscreen_task = NULL;
-static TaskHandle_t pausescreen_task = NULL;
-static TaskHandle_t cheatview_task = NULL;
+static TaskHandle_t screens_task = NULL;
 static TaskHandle_t bufferswap = NULL;
-static TaskHandle_t statemachine = NULL;
 static TaskHandle_t send_task = NULL;
 static TaskHandle_t receive_task = NULL;
+static TaskHandle_t sound_task = NULL;
 
 static SemaphoreHandle_t DrawSignal = NULL;
 static SemaphoreHandle_t ScreenLock = NULL;
-static SemaphoreHandle_t state_machine_signal = NULL;
-
-static QueueHandle_t next_state_queue = NULL;
-static QueueHandle_t reset_queue = NULL;
-static QueueHandle_t cheats_queue = NULL;
-static QueueHandle_t nextLvl_queue = NULL;
-static QueueHandle_t multipl_queue = NULL;
+static SemaphoreHandle_t FrameReady = NULL;
 
 typedef struct to_AI_data {
     char delta_x[30];
@@ -69,29 +75,178 @@ typedef struct to_AI_data {
 
 static to_AI_data_t to_AI = { 0 };
 
-typedef struct from_AI_data {
-    char move[30];
+#define INPUT_MAX_EVENTS REPLAY_MAX_EVENTS
+#define KEY_WORDS ((SDL_NUM_SCANCODES + 31) / 32)
+
+/**
+ * Key and mouse events since the last frame, filled by xGetInput() from
+ * the TUM event ring or a replay. Events beyond INPUT_MAX_EVENTS stay in
+ * the ring for the next frame. Held keys follow the events, so replays
+ * hold them just as long. now is the start of the frame in ticks since
+ * the first frame and the clock of all game logic.
+ */
+static struct {
+    tum_event_t events[INPUT_MAX_EVENTS];
+    unsigned int count;
+    uint32_t pressed[KEY_WORDS];
+    uint32_t held[KEY_WORDS];
+    TickType_t start;
+    TickType_t now;
+} input = { 0 };
+
+/**
+ * Input and AI commands of the current frame while recording or
+ * replaying
+ */
+static replay_frame_t replay_frame = { 0 };
+static unsigned int replay_command = 0;
+
+TickType_t xFrameTicks(void)
+{
+    return input.now;
+}
 
-    SemaphoreHandle_t lock;
-} from_AI_data_t;
+void xGetInput(void)
+{
+    tum_event_t *event;
+    tum_event_t live;
+    uint32_t bit;
 
-static from_AI_data_t from_AI = { 0 };
+    for (int i = 0; i < KEY_WORDS; i++) {
+        input.pressed[i] = 0;
+    }
 
-typedef struct buttons_buffer {
-    unsigned char buttons[SDL_NUM_SCANCODES];
-    SemaphoreHandle_t lock;
-} buttons_buffer_t;
+    if (xReplayMode() == REPLAY_PLAY) {
+        if (xReplayReadFrame(&replay_frame)) {
+            exit(EXIT_SUCCESS);     // the replay result is printed on exit
+        }
+        memcpy(input.events, replay_frame.events,
+               replay_frame.event_count * sizeof(tum_event_t));
+        input.count = replay_frame.event_count;
+        input.now = replay_frame.tick;
+        replay_command = 0;
+
+        // live events are still pumped, drop them before the ring fills
+        while (!tumEventPop(&live)) {
+        }
+    } else {
+        for (input.count = 0; input.count < INPUT_MAX_EVENTS; input.count++) {
+            if (tumEventPop(&input.events[input.count])) {
+                break;
+            }
+        }
+        input.now = xTaskGetTickCount() - input.start;
+    }
 
-static buttons_buffer_t buttons = { 0 };
+    for (unsigned int i = 0; i < input.count; i++) {
+        event = &input.events[i];
+        bit = 1U << (event->code % 32);
 
+        if (event->type == TUM_EVENT_KEY_DOWN) {
+            input.pressed[event->code / 32] |= bit;
+            input.held[event->code / 32] |= bit;
+        } else if (event->type == TUM_EVENT_KEY_UP) {
+            input.held[event->code / 32] &= ~bit;
+        }
+    }
+}
 
-void xGetButtonInput(void)
+/**
+ * @brief next AI command for this frame, -1 if there is none
+ *
+ * Commands are recorded and replayed along with the input.
+ */
+int xGetAICommand(ai_command_t *cmd)
 {
-    if (xSemaphoreTake(buttons.lock, 0) == pdTRUE) {
-        xQueueReceive(buttonInputQueue, &buttons.buttons, 0);
-        xSemaphoreGive(buttons.lock);
+    char *recorded;
+
+    if (xReplayMode() == REPLAY_PLAY) {
+        if (replay_command == replay_frame.command_count) {
+            return -1;
+        }
+        memset(cmd, 0, sizeof(ai_command_t));
+        strcpy(cmd->raw, replay_frame.commands[replay_command++]);
+        return 0;
+    }
+
+    // commands the frame cannot record stay in the mailbox for the next
+    if (xReplayMode() == REPLAY_RECORD &&
+        replay_frame.command_count == REPLAY_MAX_COMMANDS) {
+        return -1;
+    }
+
+    if (xAICommandPop(cmd)) {
+        return -1;
+    }
+
+    if (xReplayMode() == REPLAY_RECORD) {
+        recorded = replay_frame.commands[replay_frame.command_count++];
+        strncpy(recorded, cmd->raw, AI_CMD_LEN - 1);
+        recorded[AI_CMD_LEN - 1] = '\0';
     }
-}  
+
+    return 0;
+}
+
+/**
+ * @brief folds the game state into the replay digest and records the
+ * frame
+ */
+void vEndFrame(void)
+{
+    if (xReplayMode() == REPLAY_OFF) {
+        return;
+    }
+
+    vReplayDigest(xScreenCurrent());
+    vReplayDigest(vGet_highScore());
+    vReplayDigest(vGet_deltaX());
+    vReplayDigest(vGet_attacking());
+
+    if (xReplayMode() == REPLAY_RECORD) {
+        replay_frame.tick = input.now;
+        memcpy(replay_frame.events, input.events,
+               input.count * sizeof(tum_event_t));
+        replay_frame.event_count = input.count;
+
+        if (xReplayWriteFrame(&replay_frame)) {
+            PRINT_ERROR("Failed to record frame");
+        }
+        replay_frame.command_count = 0;
+    }
+}
+
+/**
+ * @brief key is held down
+ */
+unsigned char xKeyHeld(SDL_Scancode key)
+{
+    return (input.held[key / 32] >> (key % 32)) & 1;
+}
+
+/**
+ * @brief key went down since the last frame, even if already released
+ */
+unsigned char xKeyPressed(SDL_Scancode key)
+{
+    return (input.pressed[key / 32] >> (key % 32)) & 1;
+}
+
+/**
+ * @brief event time of the first press of key since the last frame, 0 if
+ * it was not pressed
+ */
+int64_t xKeyPressedAt(SDL_Scancode key)
+{
+    for (unsigned int i = 0; i < input.count; i++) {
+        if (input.events[i].type == TUM_EVENT_KEY_DOWN &&
+            input.events[i].code == key) {
+            return input.events[i].time_ns;
+        }
+    }
+
+    return 0;
+}
 
 void checkDraw(unsigned char status, const char *msg)
 {
@@ -105,670 +260,871 @@ void checkDraw(unsigned char status, const char *msg)
     }
 }
 
-#define FPS_AVERAGE_COUNT 50
 #define FPS_FONT "IBMPlexSans-Bold.ttf"
 
-void vDrawFPS(void)
+/**
+ * @brief draws frame rate and frame time percentiles of the last second
+ */
+void vDrawFrameTiming(void)
 {
-    static unsigned int periods[FPS_AVERAGE_COUNT] = { 0 };
-    static unsigned int periods_total = 0;
-    static unsigned int index = 0;
-    static unsigned int average_count = 0;
-    static TickType_t xLastWakeTime = 0, prevWakeTime = 0;
-    static char str[10] = { 0 };
+    static char str[40] = { 0 };
     static int text_width;
-    int fps = 0;
+    frame_timing_t frame;
     font_handle_t cur_font = tumFontGetCurFontHandle();
 
-    xLastWakeTime = xTaskGetTickCount();
+    vFrameTimingGet(FRAME_PHASE_FRAME, &frame);
 
-    if (prevWakeTime != xLastWakeTime) {
-        periods[index] =
-            configTICK_RATE_HZ / (xLastWakeTime - prevWakeTime);
-        prevWakeTime = xLastWakeTime;
+    tumFontSelectFontFromName(FPS_FONT);
+
+    if (frame.count) {
+        sprintf(str, "FPS: %2.0f  p99 %.1f ms", 1000 / frame.mean_ms,
+                frame.p99_ms);
+    } else {
+        sprintf(str, "FPS: --");
     }
-    else {
-        periods[index] = 0;
+
+    if (!tumGetTextSize((char *)str, &text_width, NULL))
+        checkDraw(tumDrawText(str, SCREEN_WIDTH - text_width - 10,
+                              SCREEN_HEIGHT - DEFAULT_FONT_SIZE * 1.5,
+                              Skyblue),
+                  __FUNCTION__);
+
+    tumFontSelectFontFromHandle(cur_font);
+    tumFontPutFontHandle(cur_font);
+}
+
+void vReportFrameTiming(void)
+{
+    vFrameTimingReport(stdout);
+}
+
+#define OVERLAY_FONT_SIZE 10
+#define OVERLAY_X 545
+#define OVERLAY_Y 10
+
+/**
+ * @brief draws one line of small debug text in the right margin
+ */
+void vDrawOverlayLine(unsigned int line, const char *str)
+{
+    ssize_t prev_size = tumFontGetCurFontSize();
+
+    tumFontSetSize(OVERLAY_FONT_SIZE);
+    checkDraw(tumDrawText((char *)str, OVERLAY_X,
+                          OVERLAY_Y + line * OVERLAY_FONT_SIZE * 1.2,
+                          Skyblue),
+              __FUNCTION__);
+    tumFontSetSize(prev_size);
+}
+
+void vDrawAILinkStats(void)
+{
+    static char str[40] = { 0 };
+    ai_link_stats_t stats;
+
+    vAILinkGetStats(&stats);
+
+    vDrawOverlayLine(0, "AI link");
+    sprintf(str, "tx %lu rx %lu", stats.sent, stats.received);
+    vDrawOverlayLine(1, str);
+    sprintf(str, "lost %lu reord %lu", stats.lost, stats.reordered);
+    vDrawOverlayLine(2, str);
+    sprintf(str, "dropped %lu", stats.dropped);
+    vDrawOverlayLine(3, str);
+
+    if (!stats.stamped) {
+        vDrawOverlayLine(4, "no timestamps");
+        return;
     }
 
-    periods_total += periods[index];
+    sprintf(str, "rtt %.1f ms", stats.rtt_avg_ms);
+    vDrawOverlayLine(4, str);
+    sprintf(str, "  max %.1f ms", stats.rtt_max_ms);
+    vDrawOverlayLine(5, str);
+    sprintf(str, "stale %.1f ms", stats.stale_avg_ms);
+    vDrawOverlayLine(6, str);
+    sprintf(str, "  max %.1f ms", stats.stale_max_ms);
+    vDrawOverlayLine(7, str);
+}
+
+#define FRAME_TIMING_LINE 30
 
-    if (index == (FPS_AVERAGE_COUNT - 1)) {
-        index = 0;
+/**
+ * @brief draws p50, p99 and max of every frame phase over the last second
+ */
+void vDrawFrameTimingStats(void)
+{
+    static char str[40] = { 0 };
+    frame_timing_t timing;
+    unsigned int line = FRAME_TIMING_LINE;
+
+    vDrawOverlayLine(line++, "ms   p50 p99 max");
+    for (int i = 0; i < FRAME_PHASES; i++) {
+        vFrameTimingGet(i, &timing);
+        sprintf(str, "%.4s %.2f %.2f %.2f", pcFrameTimingName(i),
+                timing.p50_ms, timing.p99_ms, timing.max_ms);
+        vDrawOverlayLine(line++, str);
     }
-    else {
-        index++;
+}
+
+#define TASK_STATS_PERIOD_MS 1000
+#define TASK_STATS_CSV "task_stats.csv"
+#define TASK_STATS_LINE 9
+#define TASK_STATS_SHOWN 8
+
+/**
+ * @brief draws CPU load, switches and longest blocking of the busiest tasks
+ */
+void vDrawTaskStats(void)
+{
+    static char str[40] = { 0 };
+    task_stats_t tasks[TASK_STATS_SHOWN];
+    screen_stats_t screen_stats;
+    frame_pacer_stats_t frame_stats;
+    tum_sound_stats_t sound_stats;
+    unsigned int count, i;
+    unsigned int line = TASK_STATS_LINE;
+
+    count = uiTaskStatsGet(tasks, TASK_STATS_SHOWN);
+
+    vDrawOverlayLine(line++, "Tasks");
+    for (i = 0; i < count; i++) {
+        sprintf(str, "%.11s %.1f%%", tasks[i].name, tasks[i].cpu_load);
+        vDrawOverlayLine(line++, str);
+        sprintf(str, "  sw %lu blk %.1fms", tasks[i].switches,
+                tasks[i].max_block_us / 1000.0);
+        vDrawOverlayLine(line++, str);
     }
 
-    if (average_count < FPS_AVERAGE_COUNT) {
-        average_count++;
+    vScreenGetStats(&screen_stats);
+    sprintf(str, "screen sw %.1f max %.1fms", screen_stats.last_us / 1000.0,
+            screen_stats.max_us / 1000.0);
+    vDrawOverlayLine(line++, str);
+
+    vFramePacerGetStats(&frame_stats);
+    sprintf(str, "frames %lu missed %lu", frame_stats.frames,
+            frame_stats.missed);
+    vDrawOverlayLine(line++, str);
+
+    tumSoundGetStats(&sound_stats);
+    sprintf(str, "snd %lu drop %lu cut %lu", sound_stats.played,
+            sound_stats.dropped, sound_stats.stolen);
+    vDrawOverlayLine(line++, str);
+
+    sprintf(str, "input drop %u", tumEventDropped());
+    vDrawOverlayLine(line++, str);
+}
+
+#if (configUSE_PROF_ZONES == 1)
+
+#define PROF_ZONES_CSV "prof_zones.csv"
+#define PROF_ZONES_SHOWN 16
+
+/**
+ * @brief draws the CPU time per frame of the profiling zones over the last
+ * second, in place of the task statistics
+ */
+void vDrawProfZones(void)
+{
+    static char str[40] = { 0 };
+    prof_zone_stats_t zones[PROF_ZONES_SHOWN];
+    unsigned int count, i;
+    unsigned int line = TASK_STATS_LINE;
+
+    count = uiProfZonesGet(zones, PROF_ZONES_SHOWN);
+
+    vDrawOverlayLine(line++, "us    mean  max");
+    for (i = 0; i < count; i++) {
+        sprintf(str, "%.5s %5.0f %4.0f", zones[i].name, zones[i].mean_us,
+                zones[i].max_us);
+        vDrawOverlayLine(line++, str);
     }
-    else {
-        periods_total -= periods[index];
+}
+
+void vReportProfZones(void)
+{
+    vProfZonesReport(stdout);
+}
+
+#endif
+
+#if (configUSE_INPUT_LATENCY == 1)
+
+#define SYNTHETIC_START 1000        // ms until SPACE starts the game
+#define SYNTHETIC_SHOT_PERIOD 250   // ms between two presses of W
+#define SYNTHETIC_SAMPLES 500       // shots measured before exiting
+
+static struct {
+    int enabled;
+    int started;
+    int shooting;
+    TickType_t last_shot;
+} synthetic = { 0 };
+
+/**
+ * Drives the game without a keyboard, called after fetching events. SPACE
+ * is held from SYNTHETIC_START on, which also restarts the game after a
+ * game over, W is tapped every SYNTHETIC_SHOT_PERIOD and released at the
+ * next poll.
+ * Presses while a projectile is still flying have no effect and are not
+ * measured.
+ */
+void vSyntheticInput(void)
+{
+    TickType_t now = xTaskGetTickCount();
+
+    if (!synthetic.started) {
+        if (now >= pdMS_TO_TICKS(SYNTHETIC_START)) {
+            tumEventInject(TUM_EVENT_KEY_DOWN, KEYCODE(SPACE));
+            synthetic.started = 1;
+            synthetic.last_shot = now;
+        }
+        return;
     }
 
-    fps = periods_total / average_count;
+    if (synthetic.shooting) {
+        tumEventInject(TUM_EVENT_KEY_UP, KEYCODE(W));
+        synthetic.shooting = 0;
+    } else if (now - synthetic.last_shot >=
+               pdMS_TO_TICKS(SYNTHETIC_SHOT_PERIOD)) {
+        tumEventInject(TUM_EVENT_KEY_DOWN, KEYCODE(W));
+        synthetic.shooting = 1;
+        synthetic.last_shot = now;
+    }
 
-    tumFontSelectFontFromName(FPS_FONT);
+    if (ulInputLatencySamples() >= SYNTHETIC_SAMPLES) {
+        exit(EXIT_SUCCESS);
+    }
+}
 
-    sprintf(str, "FPS: %2d", fps);
+void vReportInputLatency(void)
+{
+    vInputLatencyReport(stdout);
+}
 
-    if (!tumGetTextSize((char *)str, &text_width, NULL))
-        checkDraw(tumDrawText(str, SCREEN_WIDTH - text_width - 10,
-                              SCREEN_HEIGHT - DEFAULT_FONT_SIZE * 1.5,
-                              Skyblue),
-                  __FUNCTION__);
+#endif
 
-    tumFontSelectFontFromHandle(cur_font);
-    tumFontPutFontHandle(cur_font);
+void vReportFrames(void)
+{
+    vFramePacerReport(stdout);
 }
 
-void vSwapBuffers(void *pvParameters)
+void vReportSound(void)
 {
-    TickType_t xLastWakeTime;
-    xLastWakeTime = xTaskGetTickCount();
-    const TickType_t frameratePeriod = 15;
+    tum_sound_stats_t stats;
 
-    tumDrawBindThread();
+    tumSoundGetStats(&stats);
+    printf("Sound: %lu samples queued, %lu played, %lu dropped, %lu cut off\n",
+           stats.queued, stats.played, stats.dropped, stats.stolen);
+}
 
-    while (1) {
-        if (xSemaphoreTake(ScreenLock, portMAX_DELAY) == pdTRUE) {
-            tumDrawUpdateScreen();
-            tumEventFetchEvents(FETCH_EVENT_BLOCK);
-            xSemaphoreGive(ScreenLock);
-            xSemaphoreGive(DrawSignal);
-            vTaskDelayUntil(&xLastWakeTime,
-                            pdMS_TO_TICKS(frameratePeriod));
-        }
+/**
+ * Polls SDL events and publishes them to the event ring, SDL wants this
+ * done by the task holding the GL context
+ */
+static void vPumpInput(void)
+{
+    tumEventFetchEvents(FETCH_EVENT_NONBLOCK);
+#if (configUSE_INPUT_LATENCY == 1)
+    if (synthetic.enabled) {
+        vSyntheticInput();
     }
+#endif
 }
 
+/**
+ * Presents every frame the screens task has drawn, when the frame pacer
+ * says it is due, and then lets it draw the next one. While waiting for
+ * either, input is pumped every INPUT_PUMP_PERIOD, so events reach the
+ * ring independently of how long drawing takes.
+ */
+void vSwapBuffers(void *pvParameters)
+{
+    uint64_t start, rendered, presented, last_present = 0;
 
-// TASKS #########################################################################
+    tumDrawBindThread();
 
-void vStart_screen(void *pvParameters) {
+    xSemaphoreGive(DrawSignal);
 
-    unsigned short state = 0;
-    int ticks = 0;
+    while (1) {
+        while (xFramePacerWait(pdMS_TO_TICKS(INPUT_PUMP_PERIOD))) {
+            vPumpInput();
+        }
+        while (xSemaphoreTake(FrameReady,
+                              pdMS_TO_TICKS(INPUT_PUMP_PERIOD)) != pdTRUE) {
+            vPumpInput();
+        }
 
-    signed short mouse_X = 0;
-    signed short mouse_Y = 0;
+        xSemaphoreTake(ScreenLock, portMAX_DELAY);
+        start = tumUtilTimeNs();
+        if (!tumDrawRender()) {
+            rendered = tumUtilTimeNs();
+            tumDrawPresent();
+            presented = tumUtilTimeNs();
+
+            vFrameTimingRecord(FRAME_PHASE_RENDER, rendered - start);
+            vFrameTimingRecord(FRAME_PHASE_PRESENT, presented - rendered);
+            if (last_present) {
+                vFrameTimingRecord(FRAME_PHASE_FRAME,
+                                   presented - last_present);
+            }
+            last_present = presented;
+        }
+        vFramePacerPresented();
+#if (configUSE_INPUT_LATENCY == 1)
+        vInputLatencyPresented();
+#endif
+        xSemaphoreGive(ScreenLock);
 
-    int buttonState_Mouse = 0;
-    int lastState_Mouse = 0;
-    clock_t lastDebounceTime_Mouse;
+        // the next frame starts with what arrived while presenting
+        vPumpInput();
+        xSemaphoreGive(DrawSignal);
+    }
+}
 
-    clock_t timestamp;
-    double debounce_delay = 0.025;
 
-    int next_state_play = 1;
-    int next_state_cheats = 3;
+// SCREENS #######################################################################
 
-    int multiplayer = 1;
-    char highscore[10];
+#define SCREEN_CHANGE_PERIOD 500
+#define BANNER_PERIOD 2000
 
-    int hscore = 0;
+enum {
+    SCREEN_MAIN_MENU = 0,
+    SCREEN_PLAY,
+    SCREEN_PAUSE,
+    SCREEN_CHEATS,
+    SCREEN_GAME_OVER,
+    SCREEN_NEXT_LEVEL,
+};
 
-    int button_pressed = 0;
+/**
+ * Game settings handed from the menus to the play screen
+ */
+static struct {
+    int level;
+    int multiplayer;
+    unsigned int Flags[4];
+} game = { .level = 1, .multiplayer = 1 };
 
-    while(1) {
-        if (DrawSignal) {
-            if (xSemaphoreTake(DrawSignal, portMAX_DELAY) ==
-                pdTRUE) {
-                xGetButtonInput(); // Update global input
-                // currently in state 0
-                /* when SPACE is pressed send signal 
-                    to state machine to go to state 1
-                    -> enter game 
-                */
-                if (xSemaphoreTake(buttons.lock, 0) == pdTRUE) { 
-                    if(buttons.buttons[KEYCODE(SPACE)]) {   // start game
-                        xSemaphoreGive(buttons.lock);
-                        // read h-score from file
-                        FILE *fp;
-                        fp = fopen("../src/hscore.txt", "r");
-                        while (fgets(highscore, 10, fp) != NULL) {
-                            printf("%s\n", highscore);
-                        }
-                        fclose(fp);
-
-                        hscore = strtol(highscore, NULL, 0);
-
-                        vGive_highScore(hscore);
-
-                        xQueueSendToFront(multipl_queue, &multiplayer, 0);
-                        xSemaphoreGive(state_machine_signal);
-                        xQueueSend(next_state_queue, &next_state_play, 0);
-                    }
-                    xSemaphoreGive(buttons.lock);
-                }
-                // check button inputs
-                // get mouse coordinates 
-                mouse_X = tumEventGetMouseX();
-                mouse_Y = tumEventGetMouseY();
+// MAIN MENU ---------------------------------------------------------------------
 
-                int reading_Mouse = tumEventGetMouseLeft();
+static struct {
+    unsigned short state;
+    int ticks;
 
-                if (reading_Mouse != lastState_Mouse) {
-                    lastDebounceTime_Mouse = clock();
-                }
-                timestamp = clock();
-                if((((double) (timestamp - lastDebounceTime_Mouse)
-                        )/ CLOCKS_PER_SEC) > debounce_delay){
-                    if (reading_Mouse != buttonState_Mouse){
-                        buttonState_Mouse = reading_Mouse;
-                         
-                        if (buttonState_Mouse == 1){
-                                button_pressed = vCheckMainMenuButtonInput(
-                                                            mouse_X, 
-                                                            mouse_Y);
-                            if (button_pressed == 1) {
-                                xSemaphoreGive(state_machine_signal);
-                                xQueueSend(next_state_queue, 
-                                            &next_state_cheats, 0);
-                            }
-                            if (button_pressed == 2) {
-                                if (multiplayer == 1) {
-                                    multiplayer = 0;
-                                }
-                                else {
-                                    multiplayer = 1;
-                                }
-                            }
-                        }
-                    }
-                }
-                lastState_Mouse = reading_Mouse;
+    int multiplayer;
+} start = { .multiplayer = 1 };
 
-                xSemaphoreTake(ScreenLock, portMAX_DELAY);
+void vStartScreenEnter(int from)
+{
+    game.level = 1;
+}
 
-                vDrawMainMenu(state, multiplayer);
-                
-                vDrawFPS();
+void vStartScreenUpdate(void)
+{
+    tum_event_t *event;
+    int button_pressed = 0;
 
-                xSemaphoreGive(ScreenLock);
+    /* when SPACE is pressed change to the play screen
+        -> enter game
+    */
+    if (xKeyHeld(KEYCODE(SPACE))) {   // start game
+        xScreenRequest(SCREEN_PLAY);
+    }
+    // check button inputs at the position they were clicked
+    for (unsigned int i = 0; i < input.count; i++) {
+        event = &input.events[i];
+        if (event->type != TUM_EVENT_MOUSE_DOWN ||
+            event->code != SDL_BUTTON_LEFT) {
+            continue;
+        }
 
-                if (ticks == 50)    {
-                    if (state == 1)   {
-                        state = 0;
-                    }   
-                    else {
-                        state = 1;
-                    }
-                    ticks = 0;
-                }
-                ticks++;
+        button_pressed = vCheckMainMenuButtonInput(event->x, event->y);
+        if (button_pressed == 1) {
+            xScreenRequest(SCREEN_CHEATS);
+        }
+        if (button_pressed == 2) {
+            start.multiplayer = !start.multiplayer;
+        }
+    }
 
-            } 
-        } 
+    if (start.ticks == 50)    {
+        start.state = !start.state;
+        start.ticks = 0;
     }
+    start.ticks++;
 }
 
-void vPlay_screen(void *pvParameters)
+void vStartScreenDraw(void)
 {
-    int next_state_pause = 2;
-    int next_state_play = 1;
-    int next_state_mainmenu = 0;
+    vDrawMainMenu(start.state, start.multiplayer);
+}
 
-    int ticks = 0;
+void vStartScreenExit(int to)
+{
+    char highscore[10] = "0";
+    FILE *fp;
 
-    int delta_X = 0;
-    int active = 0;
-    int difficulty = 0;
+    if (to != SCREEN_PLAY) {
+        return;
+    }
 
-    unsigned int game_over = 0;
+    // read h-score from file
+    fp = fopen("../src/hscore.txt", "r");
+    if (fp != NULL) {
+        while (fgets(highscore, 10, fp) != NULL) {
+            printf("%s\n", highscore);
+        }
+        fclose(fp);
+    }
 
-    int buttonState_W = 0;
-    int lastState_W = 0;
-    clock_t lastDebounceTime_W;
+    vGive_highScore(strtol(highscore, NULL, 0));
 
-    int buttonState_C = 0;
-    int lastState_C = 0;
-    clock_t lastDebounceTime_C;
+    game.multiplayer = start.multiplayer;
+}
 
-    clock_t timestamp;
-    double debounce_delay = 0.025;
+// PLAY SCREEN -------------------------------------------------------------------
 
-    int reset = 0;
+static struct {
+    int ticks;
+    unsigned int game_over;
+
+    int reset;
     /** 
      * Signals for play_dynamics.c;
      * Flag 0: move left; Flag 1: move right
      * Flag 2: shoot; Flag 3: trigger laser shot
      * Flag 4: toggle difficulty
      */
-    unsigned int Flags[5] = { 0 };
+    unsigned int Flags[5];
 
-    TickType_t xLastWakeTime, prevWakeTime;
-    xLastWakeTime = xTaskGetTickCount();
-    prevWakeTime = xLastWakeTime;
+    unsigned int show_link_stats;
+    unsigned int show_task_stats;
+    unsigned int show_frame_timing;
+    unsigned int show_prof_zones;
 
-    while (1) {
-        if (DrawSignal) {
-            if (xSemaphoreTake(DrawSignal, portMAX_DELAY) ==
-                pdTRUE) {
-                xLastWakeTime = xTaskGetTickCount();
-                xQueueReceive(reset_queue, &reset, 0);
-                if (reset || game_over == 2) {
-                    prevWakeTime = xLastWakeTime;
-                    reset = 0;
-                }
-                
-                xGetButtonInput(); // Update global input
-                // currently in state 1
-                /* when escape is pressed send signal 
-                    to state machine to go to state 2
-                    -> PAUSE screen
-                */ 
-                if (xSemaphoreTake(buttons.lock, 0) == pdTRUE) {
-
-                    if (buttons.buttons[KEYCODE(ESCAPE)]) {
-                        xSemaphoreGive(buttons.lock);
-                        xSemaphoreGive(state_machine_signal);
-                        xQueueSend(next_state_queue, &next_state_pause, 0);
-                    }
-                    if (buttons.buttons[KEYCODE(A)]) {
-                        Flags[0] = 1;
-                    }
+    TickType_t xLastWakeTime;
+    TickType_t prevWakeTime;
+} play = { 0 };
 
-                    if (buttons.buttons[KEYCODE(D)]) {
-                        Flags[1] = 1;
-                    }
-                    int reading_W = buttons.buttons[KEYCODE(W)];
-                    if (reading_W != lastState_W) {
-                        lastDebounceTime_W = clock();
-                    }
-                    timestamp = clock();
-                    if ((((double) (timestamp - lastDebounceTime_W)
-                            )/ CLOCKS_PER_SEC) > debounce_delay) {
-                        if (reading_W != buttonState_W) {
-                            buttonState_W = reading_W;
-                            if (buttonState_W) {
-                                Flags[2] = 1;
-                            }
-                        }
-                    } 
-                    lastState_W = reading_W;
-
-                    int reading_C = buttons.buttons[KEYCODE(C)];
-                    if (reading_C != lastState_C) {
-                        lastDebounceTime_C = clock();
-                    }
-                    timestamp = clock();
-                    if ((((double) (timestamp - lastDebounceTime_C)
-                            )/ CLOCKS_PER_SEC) > debounce_delay) {
-                        if (reading_C != buttonState_C) {
-                            buttonState_C = reading_C;
-                            if (buttonState_C) {
-                                Flags[4] = 1;
-                            }
-                        }
-                    }
-                    lastState_C = reading_C;
+void vPlayScreenEnter(int from)
+{
+    // starting game from main menu
+    if (from == SCREEN_MAIN_MENU) {
+        // if cheats set initialize with cheat Flags
+        if (game.Flags[0]) {
+            vInit_playscreen(game.Flags[1],
+                        game.Flags[2], game.Flags[3], game.multiplayer);
+        }
+        // else initialize with standard values
+        else {
+            vInit_playscreen(0,0,game.level, game.multiplayer);
+        }
+    }
+    // bridge timegap for state change
+    // reset means here reset Tickcount
+    play.reset = 1;
+    play.game_over = 0;
+}
 
-                    xSemaphoreGive(buttons.lock);
-                }   
-                if (ticks == 100) { // trigger lasershot
-                    Flags[3] = 1;
-                    ticks = 0;
-                }
+void vPlayScreenUpdate(void)
+{
+    int delta_X = 0;
+    int active = 0;
+    int difficulty = 0;
+#if (configUSE_INPUT_LATENCY == 1)
+    int64_t shot_at = 0;
+#endif
 
-                if (xSemaphoreTake(from_AI.lock, 0)) {
-                    
-                    vGive_movementData(from_AI.move);
+    ai_command_t ai_cmd;
 
-                    xSemaphoreGive(from_AI.lock);
-                }
+    // the last frame is done
+    play.ticks++;
+    for (int i=0; i<5; i++) {
+        play.Flags[i] = 0;
+    }
+    play.prevWakeTime = play.xLastWakeTime;
 
-                xSemaphoreTake(ScreenLock, portMAX_DELAY);
+    // outcome of the last frame, the game ends with it
+    if (play.game_over == 1) {      // game over return to main menu
+        if (!xScreenRequest(SCREEN_GAME_OVER)) {
+            return;
+        }
+    }
+    if (play.game_over == 2) {      // next level progress
+        if (!xScreenRequest(SCREEN_NEXT_LEVEL)) {
+            return;
+        }
+    }
 
-                game_over = vDraw_playscreen(Flags, 
-                                xLastWakeTime - prevWakeTime);
+    play.xLastWakeTime = xFrameTicks();
+    if (play.reset) {
+        play.prevWakeTime = play.xLastWakeTime;
+        play.reset = 0;
+    }
 
-                vDrawFPS();
-                
-                xSemaphoreGive(ScreenLock);
+    /* when escape is pressed change to the pause screen
+    */
+    if (xKeyHeld(KEYCODE(ESCAPE))) {
+        xScreenRequest(SCREEN_PAUSE);
+    }
+    if (xKeyHeld(KEYCODE(A))) {
+        play.Flags[0] = 1;
+    }
+    if (xKeyHeld(KEYCODE(D))) {
+        play.Flags[1] = 1;
+    }
+    // shoot and toggle difficulty once per key press
+    if (xKeyPressed(KEYCODE(W))) {
+        play.Flags[2] = 1;
+    }
+    if (xKeyPressed(KEYCODE(C))) {
+        play.Flags[4] = 1;
+    }
 
-                if (game_over == 1) {       // game over return to main menu
-                    vTaskDelay(2000);
-                    xSemaphoreGive(state_machine_signal);
-                    xQueueSend(next_state_queue, 
-                                &next_state_mainmenu, 0);
-                }
-                if (game_over == 2) {       // next level progress
-                    
-                    xSemaphoreGive(state_machine_signal);
-                    xQueueSend(next_state_queue,
-                                &next_state_play, 0);
-                    vTaskDelay(2000);
-                }
+    // toggle AI link statistics on key press
+    if (xKeyPressed(KEYCODE(N))) {
+        play.show_link_stats = !play.show_link_stats;
+    }
+    // toggle task statistics on key press
+    if (xKeyPressed(KEYCODE(T))) {
+        play.show_task_stats = !play.show_task_stats;
+        play.show_prof_zones = 0;
+    }
+#if (configUSE_PROF_ZONES == 1)
+    // profiling zones take the place of the task statistics
+    if (xKeyPressed(KEYCODE(P))) {
+        play.show_prof_zones = !play.show_prof_zones;
+        play.show_task_stats = 0;
+    }
+#endif
+    // toggle frame phase timing on key press
+    if (xKeyPressed(KEYCODE(F))) {
+        play.show_frame_timing = !play.show_frame_timing;
+    }
+    if (play.ticks == 100) { // trigger lasershot
+        play.Flags[3] = 1;
+        play.ticks = 0;
+    }
 
-                // retrieve delta x data from Game (format: string)
-                // retrieve attacking/passive data from Game (string)
-                if (xSemaphoreTake(to_AI.lock, 0)) {
-                        
-                    delta_X = vGet_deltaX();
+    // apply every command received since the last frame
+    while (!xGetAICommand(&ai_cmd)) {
+        vGive_movementData(ai_cmd.raw);
+    }
 
-                    active = vGet_attacking();
+    // retrieve delta x data from Game (format: string)
+    // retrieve attacking/passive data from Game (string)
+    if (xSemaphoreTake(to_AI.lock, 0)) {
 
-                    difficulty = vGet_difficulty();
-                    
-                    sprintf(to_AI.delta_x, "%i", delta_X);
+        delta_X = vGet_deltaX();
 
-                    if (active) {
-                        sprintf(to_AI.attacking, "ATTACKING");
-                    }
-                    else {
-                        sprintf(to_AI.attacking, "PASSIVE");
-                    }
+        active = vGet_attacking();
 
-                    sprintf(to_AI.difficulty, "D%i", difficulty);
-                    
-                    xSemaphoreGive(to_AI.lock);
-                }
+        difficulty = vGet_difficulty();
 
-                ticks++;
+        sprintf(to_AI.delta_x, "%i", delta_X);
 
-                Flags[0] = 0;
-                Flags[1] = 0;
-                Flags[2] = 0;
-                Flags[3] = 0;
-                Flags[4] = 0;
+        if (active) {
+            sprintf(to_AI.attacking, "ATTACKING");
+        }
+        else {
+            sprintf(to_AI.attacking, "PASSIVE");
+        }
+
+        sprintf(to_AI.difficulty, "D%i", difficulty);
+
+        xSemaphoreGive(to_AI.lock);
+    }
 
-                prevWakeTime = xLastWakeTime;
-            } 
-        } 
+#if (configUSE_INPUT_LATENCY == 1)
+    // a shot is only fired if no projectile is flying
+    if (play.Flags[2] && !vGet_attacking()) {
+        shot_at = xKeyPressedAt(KEYCODE(W));
     }
+#endif
+
+    // the AI above gets the state of the last frame
+    play.game_over = vUpdate_playscreen(play.Flags,
+                        play.xLastWakeTime - play.prevWakeTime);
+
+#if (configUSE_INPUT_LATENCY == 1)
+    if (shot_at && vGet_attacking()) {
+        vInputLatencyEffect(shot_at);
+    }
+#endif
 }
 
-void vPauseScreen(void *pvParameters) {
+void vPlayScreenDraw(void)
+{
+    vDraw_playscreen(play.game_over);
 
-    int next_state_mainmenu = 0;
-    int next_state_play = 1;
+    if (play.show_link_stats) {
+        vDrawAILinkStats();
+    }
+    if (play.show_task_stats) {
+        vDrawTaskStats();
+    }
+    if (play.show_frame_timing) {
+        vDrawFrameTimingStats();
+    }
+#if (configUSE_PROF_ZONES == 1)
+    if (play.show_prof_zones) {
+        vDrawProfZones();
+    }
+#endif
+}
 
-    while(1) {
-        if (xSemaphoreTake(DrawSignal, portMAX_DELAY) ==
-                pdTRUE) {
-                xGetButtonInput(); // Update global input
-                // currently in state 2
-                /* when escape is pressed send signal 
-                    to state machine to go to state 0
-                    -> start screen
-                */ 
-                if (xSemaphoreTake(buttons.lock, 0) == pdTRUE) {
-
-                    if(buttons.buttons[KEYCODE(ESCAPE)]) {
-                        xSemaphoreGive(buttons.lock);
-                        // write high score to file 
-                        FILE *fp;
-                        fp = fopen("../src/hscore.txt", "w");
-                        if (fp != NULL) {
-                            fprintf(fp, "%i", vGet_highScore());
-                        }
-                        fclose(fp);
-
-                        xSemaphoreGive(state_machine_signal);
-                        xQueueSend(next_state_queue, &next_state_mainmenu, 0);
-                    }
-                    /* when SPACE is pressed send signal
-                        to state machine to go to state 1
-                        -> resume playing
-                    */
-                    if(buttons.buttons[KEYCODE(SPACE)]) {
-                        xSemaphoreGive(buttons.lock);
-                        xSemaphoreGive(state_machine_signal);
-                        xQueueSend(next_state_queue, &next_state_play, 0);
-                    }
-                    xSemaphoreGive(buttons.lock);
-                }
+// GAME OVER AND NEXT LEVEL ---------------------------------------------------
 
-                xSemaphoreTake(ScreenLock, portMAX_DELAY);
+/**
+ * Both banners are shown for BANNER_PERIOD while the frame loop keeps
+ * running, the play screen restarts its clock when entered again
+ */
+void vGameOverEnter(int from)
+{
+    xScreenRequestAfter(SCREEN_MAIN_MENU, pdMS_TO_TICKS(BANNER_PERIOD));
+}
 
-                vDrawPauseScreen();
-                
-                vDrawFPS();
+void vGameOverDraw(void)
+{
+    vDrawGameOver();
+}
 
-                xSemaphoreGive(ScreenLock);
+static unsigned int next_level_shown = 0;
 
-        } 
+void vNextLevelEnter(int from)
+{
+    game.level++;
+    // cheat init for next level
+    if (game.Flags[0]) {
+        next_level_shown = game.Flags[3] + game.level-1;
+        vInit_playscreen(game.Flags[1], 0, next_level_shown,
+                         game.multiplayer);
+    }
+    // normal init
+    else {
+        next_level_shown = game.level;
+        vInit_playscreen(0,0,game.level, game.multiplayer);
     }
+
+    xScreenRequestAfter(SCREEN_PLAY, pdMS_TO_TICKS(BANNER_PERIOD));
 }
 
-void vCheatView(void *pvParameters) {
+void vNextLevelDraw(void)
+{
+    vDrawNextLevelScreen(next_level_shown);
+}
 
-    int next_state_mainmenu = 0;
+// PAUSE SCREEN ------------------------------------------------------------------
 
-    signed short mouse_X = 0;
-    signed short mouse_Y = 0;
+void vPauseScreenUpdate(void)
+{
+    /* when escape is pressed change to the main menu
+    */
+    if (xKeyHeld(KEYCODE(ESCAPE))) {
+        xScreenRequest(SCREEN_MAIN_MENU);
+    }
+    /* when SPACE is pressed change to the play screen
+        -> resume playing
+    */
+    if (xKeyHeld(KEYCODE(SPACE))) {
+        xScreenRequest(SCREEN_PLAY);
+    }
+}
 
-    int buttonState_Mouse = 0;
-    int lastState_Mouse = 0;
-    clock_t lastDebounceTime_Mouse;
+void vPauseScreenDraw(void)
+{
+    vDrawPauseScreen();
+}
 
-    clock_t timestamp;
-    double debounce_delay = 0.025;
+void vPauseScreenExit(int to)
+{
+    FILE *fp;
 
-    int buttonValue = 0;
+    if (to != SCREEN_MAIN_MENU) {
+        return;
+    }
 
-    int trigger = 0;
-    int lastTrigger = 0;
+    // write high score to file
+    fp = fopen("../src/hscore.txt", "w");
+    if (fp != NULL) {
+        fprintf(fp, "%i", vGet_highScore());
+        fclose(fp);
+    }
+}
 
-    int score = 0;
-    int level = 0;
+// CHEAT SCREEN ------------------------------------------------------------------
 
-    int cheats[4] = { 0 };
+static struct {
+    int trigger;
+    int lastTrigger;
 
-    while(1) {
-        if (xSemaphoreTake(DrawSignal, portMAX_DELAY) ==
-            pdTRUE) {
-            xGetButtonInput(); // Update global input
-            // currently in state 3
-            /* when escape is pressed send signal 
-                to state machine to go to state 0
-                -> start screen
-            */ 
-            if (xSemaphoreTake(buttons.lock, 0) == pdTRUE) {
-
-                if(buttons.buttons[KEYCODE(ESCAPE)]) {
-                    xSemaphoreGive(buttons.lock);
-                    for (int i=0; i<4; i++) {
-                        xQueueSend(cheats_queue, &cheats[i], 0);
-                    }
-                    xSemaphoreGive(state_machine_signal);
-                    xQueueSend(next_state_queue, &next_state_mainmenu, 0);
-                }
-                xSemaphoreGive(buttons.lock);
-            }
-            // check button inputs
-            // get mouse coordinates 
-            mouse_X = tumEventGetMouseX();
-            mouse_Y = tumEventGetMouseY();
+    int score;
+    int level;
 
-            int reading_Mouse = tumEventGetMouseLeft();
+    unsigned int cheats[4];
+} cheat = { 0 };
 
-            if (reading_Mouse != lastState_Mouse) {
-                lastDebounceTime_Mouse = clock();
-            }
-            timestamp = clock();
-            if((((double) (timestamp - lastDebounceTime_Mouse)
-                    )/ CLOCKS_PER_SEC) > debounce_delay){
-                if (reading_Mouse != buttonState_Mouse){
-                    buttonState_Mouse = reading_Mouse;
-                        
-                    if (buttonState_Mouse == 1){
-                        buttonValue = vCheckCheatScreenInput(mouse_X, 
-                                                                mouse_Y);
-                        switch(buttonValue) {
-                            case 1:     // button triggered
-                                trigger = buttonValue;
-                                if (trigger == lastTrigger) {
-                                    trigger = 0;
-                                }
-                                else {
-                                    trigger = 1;
-                                }
-                                lastTrigger = trigger;
-                                cheats[1] = trigger;
-                                break;
-                            case 2:     // increase score
-                                score += 10;
-                                cheats[2] = score;
-                                break;
-                            case 3:     // decrease score
-                                if (score > 0) {
-                                    score -= 10;
-                                }
-                                cheats[2] = score;
-                                break;
-                            case 4:     // increase level
-                                level++;
-                                cheats[3] = level;
-                                break;
-                            case 5:
-                                if (level > 0) {
-                                    level--;
-                                }
-                                cheats[3] = level;
-                                break;
-                            default:
-                                break;
-                        }
-                        if ((trigger == 0) && (score == 0) 
-                                && (level == 0)) {
-                            cheats[0] = 0;
-                        }
-                        else {
-                            cheats[0] = 1;
-                        }
+void vCheatViewUpdate(void)
+{
+    tum_event_t *event;
+    int buttonValue = 0;
+
+    /* when escape is pressed change to the main menu
+    */
+    if (xKeyHeld(KEYCODE(ESCAPE))) {
+        xScreenRequest(SCREEN_MAIN_MENU);
+    }
+    // check button inputs at the position they were clicked
+    for (unsigned int i = 0; i < input.count; i++) {
+        event = &input.events[i];
+        if (event->type == TUM_EVENT_MOUSE_DOWN &&
+            event->code == SDL_BUTTON_LEFT) {
+            buttonValue = vCheckCheatScreenInput(event->x, event->y);
+            switch(buttonValue) {
+                case 1:     // button triggered
+                    cheat.trigger = buttonValue;
+                    if (cheat.trigger == cheat.lastTrigger) {
+                        cheat.trigger = 0;
                     }
-                }
+                    else {
+                        cheat.trigger = 1;
+                    }
+                    cheat.lastTrigger = cheat.trigger;
+                    cheat.cheats[1] = cheat.trigger;
+                    break;
+                case 2:     // increase score
+                    cheat.score += 10;
+                    cheat.cheats[2] = cheat.score;
+                    break;
+                case 3:     // decrease score
+                    if (cheat.score > 0) {
+                        cheat.score -= 10;
+                    }
+                    cheat.cheats[2] = cheat.score;
+                    break;
+                case 4:     // increase level
+                    cheat.level++;
+                    cheat.cheats[3] = cheat.level;
+                    break;
+                case 5:
+                    if (cheat.level > 0) {
+                        cheat.level--;
+                    }
+                    cheat.cheats[3] = cheat.level;
+                    break;
+                default:
+                    break;
             }
-            lastState_Mouse = reading_Mouse;
-
-            xSemaphoreTake(ScreenLock, portMAX_DELAY);
-
-            vDrawCheatScreen(trigger,score,level);
-                
-            vDrawFPS();
-
-            xSemaphoreGive(ScreenLock);
+            if ((cheat.trigger == 0) && (cheat.score == 0)
+                    && (cheat.level == 0)) {
+                cheat.cheats[0] = 0;
+            }
+            else {
+                cheat.cheats[0] = 1;
+            }
+        }
+    }
+}
 
-        } 
-    } 
+void vCheatViewDraw(void)
+{
+    vDrawCheatScreen(cheat.trigger, cheat.score, cheat.level);
 }
 
-void vStateMachine(void *pvParameters) {
+void vCheatViewExit(int to)
+{
+    // hand the cheats to the next game
+    for (int i=0; i<4; i++) {
+        game.Flags[i] = cheat.cheats[i];
+    }
+}
 
-    vTaskSuspend(playscreen_task);
-    vTaskSuspend(pausescreen_task);
-    vTaskSuspend(cheatview_task);
+static const screen_t screens[] = {
+    [SCREEN_MAIN_MENU] = { "MainMenu", vStartScreenEnter, vStartScreenUpdate,
+                           vStartScreenDraw, vStartScreenExit },
+    [SCREEN_PLAY] = { "Play", vPlayScreenEnter, vPlayScreenUpdate,
+                      vPlayScreenDraw, NULL },
+    [SCREEN_PAUSE] = { "Pause", NULL, vPauseScreenUpdate, vPauseScreenDraw,
+                       vPauseScreenExit },
+    [SCREEN_CHEATS] = { "Cheats", NULL, vCheatViewUpdate, vCheatViewDraw,
+                        vCheatViewExit },
+    [SCREEN_GAME_OVER] = { "GameOver", vGameOverEnter, NULL, vGameOverDraw,
+                           NULL },
+    [SCREEN_NEXT_LEVEL] = { "NextLevel", vNextLevelEnter, NULL,
+                            vNextLevelDraw, NULL },
+};
+
+/**
+ * Runs all screens, a screen change is a switch of callbacks within this
+ * task
+ */
+void vScreens(void *pvParameters)
+{
+    for (int i = 0; i < sizeof(screens) / sizeof(screens[0]); i++) {
+        xScreenRegister(i, &screens[i]);
+    }
+    // screens run on the frame clock, so replays change at the same frame
+    input.start = xTaskGetTickCount();
+    vScreenSetClock(xFrameTicks);
+    xScreenStart(SCREEN_MAIN_MENU, SCREEN_CHANGE_PERIOD);
 
-    int state = 0;
-    int last_state = 0;
+    uint64_t start, input_read, updated;
 
-    int reset = 1;
+    while (1) {
+        if (xSemaphoreTake(DrawSignal, portMAX_DELAY) == pdTRUE) {
+            start = tumUtilTimeNs();
+            xGetInput(); // Update global input
+            input_read = tumUtilTimeNs();
+#if (configUSE_INPUT_LATENCY == 1)
+            vInputLatencyFrameStart();
+#endif
 
-    int level = 1;
-    int multiplayer = 1;
+            vScreenUpdate();
+            updated = tumUtilTimeNs();
 
-    unsigned int Flags[4];
-    Flags[0] = 0;
+            xSemaphoreTake(ScreenLock, portMAX_DELAY);
 
-    const int state_change_period = 500;
-    TickType_t last_change = xTaskGetTickCount();
+            vScreenDraw();
 
-    while(1) {
-        if (xSemaphoreTake(state_machine_signal, 
-                            portMAX_DELAY)) {
-            xQueueReceive(next_state_queue, &state, portMAX_DELAY);
-            if ((xTaskGetTickCount() - last_change) >
-                    state_change_period) {
+            vDrawFrameTiming();
 
-                if (state == 0) {
-                    // MAIN MENU SCREEN 
-                    vTaskSuspend(playscreen_task);
-                    vTaskSuspend(pausescreen_task);
-                    vTaskSuspend(cheatview_task);
-                    vTaskResume(startscreen_task);
+            vFrameTimingRecord(FRAME_PHASE_INPUT, input_read - start);
+            vFrameTimingRecord(FRAME_PHASE_SIMULATE, updated - input_read);
+            vFrameTimingRecord(FRAME_PHASE_RECORD,
+                               tumUtilTimeNs() - updated);
+#if (configUSE_PROF_ZONES == 1)
+            vProfFrameEnd();
+#endif
 
-                    level = 1;
+#if (configUSE_INPUT_LATENCY == 1)
+            vInputLatencyFrameSubmitted();
+#endif
+            xSemaphoreGive(ScreenLock);
+            xSemaphoreGive(FrameReady);
 
-                }
-                if (state == 1) {
-                    // PLAY SCREEN 
-                    vTaskSuspend(startscreen_task);
-                    vTaskSuspend(pausescreen_task);
-                    vTaskSuspend(cheatview_task);
-                    vTaskResume(playscreen_task);
-                    
-
-                    if (last_state == 1) {  // level progress init
-                        level++; 
-                        // cheat init for next level
-                        if (Flags[0]) {
-                            vInit_playscreen(Flags[1], 0, 
-                                             Flags[3] + level-1, 
-                                             multiplayer);
-                            vDrawNextLevelScreen(Flags[3] + level-1);
-                        }
-                        // normal init
-                        else {
-                            vInit_playscreen(0,0,level, multiplayer);
-                            vDrawNextLevelScreen(level);
-                        }
-                        
-                    }
-                    // starting game from main menu
-                    if (last_state == 0) {
-                        // receive multiplayer signal
-                        xQueueReceive(multipl_queue, &multiplayer, 0);
-                        // receive cheats
-                        for (int i=0; i<4; i++) {
-                            xQueueReceive(cheats_queue, &Flags[i], 0);
-                        }
-                        // if cheats set initialize with cheat Flags
-                        if (Flags[0]) {
-                            vInit_playscreen(Flags[1], 
-                                        Flags[2], Flags[3], multiplayer);
-                        }
-                        // else initialize with standard values
-                        else {
-                            vInit_playscreen(0,0,level, multiplayer);
-                        }
-                        
-                    }
-                    // bridge timegap for state change 
-                    // reset means here reset Tickcount
-                    xQueueSend(reset_queue, &reset, 0);
-                }
-                if (state == 2) {
-                    // PAUSE SCREEN 
-                    vTaskSuspend(playscreen_task);
-                    vTaskSuspend(startscreen_task);
-                    vTaskSuspend(cheatview_task);
-                    vTaskResume(pausescreen_task);
-                }
-                if (state == 3) {
-                    // CHEAT SCREEN
-                    vTaskSuspend(playscreen_task);
-                    vTaskSuspend(startscreen_task);
-                    vTaskSuspend(pausescreen_task);
-                    vTaskResume(cheatview_task);
-                }
-                last_change = xTaskGetTickCount();
-                last_state = state;
-            }
+            vEndFrame();
         }
     }
 }
 
+void vSendToAI(const char *token)
+{
+    char msg[AI_MSG_LEN];
+    size_t len = xAILinkFormat(token, msg);
+
+    aIOSocketPut(UDP, NULL, UDP_TRANSMIT_PORT, msg, len);
+}
+
+#define AI_LINK_DUMP_PERIOD 5
+
 void vSendTask(void *pvParameters) 
 {
     char last_delta_x[30];
     char last_attacking[30];
     char last_difficulty[10];
-    char resume[] = "RESUME";
-    char pause[] = "PAUSE";
     unsigned int paused = 0;
+    unsigned int periods = 0;
 
     while(1) {
         // sending here
@@ -779,32 +1135,24 @@ void vSendTask(void *pvParameters)
                     strcmp(last_difficulty, to_AI.difficulty)) {
                 
                 if (paused) {
-                    aIOSocketPut(UDP, NULL, UDP_TRANSMIT_PORT, 
-                                resume,
-                                strlen(resume));
+                    vSendToAI("RESUME");
                 }
 
                 if (strcmp(last_delta_x, to_AI.delta_x)) {
                     // delta X
-                    aIOSocketPut(UDP, NULL, UDP_TRANSMIT_PORT, 
-                        to_AI.delta_x,
-                        strlen(to_AI.delta_x));
+                    vSendToAI(to_AI.delta_x);
 
                     strcpy(last_delta_x, to_AI.delta_x);
                 }
                 if (strcmp(last_attacking, to_AI.attacking)) {
                     // Attacking or not
-                    aIOSocketPut(UDP, NULL, UDP_TRANSMIT_PORT, 
-                        to_AI.attacking,
-                        strlen(to_AI.attacking));
+                    vSendToAI(to_AI.attacking);
 
                     strcpy(last_attacking, to_AI.attacking);
                 }
                 if (strcmp(last_difficulty, to_AI.difficulty)) {
                     // difficulty
-                    aIOSocketPut(UDP, NULL, UDP_TRANSMIT_PORT, 
-                        to_AI.difficulty,
-                        strlen(to_AI.difficulty));
+                    vSendToAI(to_AI.difficulty);
 
                     strcpy(last_difficulty, to_AI.difficulty);
                 }
@@ -817,13 +1165,18 @@ void vSendTask(void *pvParameters)
             else {
                 if (!paused) {
                     paused = 1;
-                    aIOSocketPut(UDP, NULL, UDP_TRANSMIT_PORT,
-                         pause, strlen(pause));
+                    vSendToAI("PAUSE");
                 }
             }
 
             xSemaphoreGive(to_AI.lock); 
         }
+
+        if (++periods == AI_LINK_DUMP_PERIOD) {
+            vAILinkDumpStats(stdout);
+            periods = 0;
+        }
+
         vTaskDelay(pdMS_TO_TICKS(1000));
     }
     
@@ -831,9 +1184,8 @@ void vSendTask(void *pvParameters)
 
 void UDPHandlerOne(size_t read_size, char *buffer, void *args)
 {
-
-    strcpy(from_AI.move, buffer);
-
+    // runs in the SIGIO handler, dropped commands are only counted
+    xAICommandPush(buffer, read_size);
 }
 
 void vReceiveTask(void *pvParameters)
@@ -850,6 +1202,105 @@ void vReceiveTask(void *pvParameters)
     }
 }
 
+#if (configUSE_LOCK_PROFILE == 1)
+void vReportLocks(void)
+{
+    vLockProfReport(stdout);
+}
+#endif
+
+// RTOS objects ##########################################################
+
+#define MAIN_TASKS 5
+#define MAIN_SEMAPHORES 4
+
+#define SCHED_TRACE_JSON "sched_trace.json"
+
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+// storage of every task and semaphore created in main()
+static struct {
+    StaticTask_t tasks[MAIN_TASKS];
+    StackType_t stacks[MAIN_TASKS][mainGENERIC_STACK_SIZE * 2];
+    StaticSemaphore_t semaphores[MAIN_SEMAPHORES];
+    unsigned int task_count;
+    unsigned int semaphore_count;
+} rtos_storage = { 0 };
+
+static StaticTask_t idle_task;
+static StackType_t idle_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t timer_task;
+static StackType_t timer_stack[configTIMER_TASK_STACK_DEPTH];
+
+void vApplicationGetIdleTaskMemory(StaticTask_t **ppxIdleTaskTCBBuffer,
+                                   StackType_t **ppxIdleTaskStackBuffer,
+                                   uint32_t *pulIdleTaskStackSize)
+{
+    *ppxIdleTaskTCBBuffer = &idle_task;
+    *ppxIdleTaskStackBuffer = idle_stack;
+    *pulIdleTaskStackSize = configMINIMAL_STACK_SIZE;
+}
+
+void vApplicationGetTimerTaskMemory(StaticTask_t **ppxTimerTaskTCBBuffer,
+                                    StackType_t **ppxTimerTaskStackBuffer,
+                                    uint32_t *pulTimerTaskStackSize)
+{
+    *ppxTimerTaskTCBBuffer = &timer_task;
+    *ppxTimerTaskStackBuffer = timer_stack;
+    *pulTimerTaskStackSize = configTIMER_TASK_STACK_DEPTH;
+}
+#endif
+
+/**
+ * The game's tasks and semaphores are created through these, in a
+ * -DSTATIC_ALLOCATION build they use the preallocated rtos_storage
+ */
+BaseType_t xMainCreateTask(TaskFunction_t task, const char *name,
+                           UBaseType_t priority, TaskHandle_t *handle)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    unsigned int i = rtos_storage.task_count;
+
+    if (i == MAIN_TASKS) {
+        return pdFAIL;
+    }
+    *handle = xTaskCreateStatic(task, name, mainGENERIC_STACK_SIZE * 2,
+                                NULL, priority, rtos_storage.stacks[i],
+                                &rtos_storage.tasks[i]);
+    rtos_storage.task_count++;
+
+    return *handle ? pdPASS : pdFAIL;
+#else
+    return xTaskCreate(task, name, mainGENERIC_STACK_SIZE * 2, NULL,
+                       priority, handle);
+#endif
+}
+
+SemaphoreHandle_t xMainCreateMutex(void)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    if (rtos_storage.semaphore_count == MAIN_SEMAPHORES) {
+        return NULL;
+    }
+    return xSemaphoreCreateMutexStatic(
+               &rtos_storage.semaphores[rtos_storage.semaphore_count++]);
+#else
+    return xSemaphoreCreateMutex();
+#endif
+}
+
+SemaphoreHandle_t xMainCreateBinary(void)
+{
+#if (configSUPPORT_STATIC_ALLOCATION == 1)
+    if (rtos_storage.semaphore_count == MAIN_SEMAPHORES) {
+        return NULL;
+    }
+    return xSemaphoreCreateBinaryStatic(
+               &rtos_storage.semaphores[rtos_storage.semaphore_count++]);
+#else
+    return xSemaphoreCreateBinary();
+#endif
+}
+
 // main function #########################################################
 
 #define PRINT_TASK_ERROR(task) PRINT_ERROR("Failed to print task ##task");
@@ -858,6 +1309,43 @@ int main(int argc, char *argv[])
 {
     // initialization 
     char *bin_folder_path = tumUtilGetBinFolderPath(argv[0]);
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    unsigned int seed = time(NULL);
+    int pace = FRAME_PACE_VSYNC;
+    unsigned int fps = FRAME_CAP_FPS;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--record") && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (!strcmp(argv[i], "--replay") && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (!strcmp(argv[i], "--pace") && i + 1 < argc) {
+            pace = xFramePacerMode(argv[++i]);
+            if (pace < 0) {
+                PRINT_ERROR("Frame pacing is vsync, cap or uncapped");
+                return EXIT_FAILURE;
+            }
+        } else if (!strcmp(argv[i], "--fps") && i + 1 < argc) {
+            fps = atoi(argv[++i]);
+        }
+#if (configUSE_INPUT_LATENCY == 1)
+        else if (!strcmp(argv[i], "--synthetic-input")) {
+            synthetic.enabled = 1;
+        }
+#endif
+    }
+
+    if (replay_path) {
+        if (xReplayPlay(replay_path, &seed)) {
+            return EXIT_FAILURE;
+        }
+    } else if (record_path && xReplayRecord(record_path, seed)) {
+        return EXIT_FAILURE;
+    }
+    // the only randomness of the game are the laser shots
+    srand(seed);
+    atexit(vReplayClose);
 
     printf("Initializing: ");
 
@@ -866,6 +1354,13 @@ int main(int argc, char *argv[])
         goto err_init_drawing;
     }
 
+    if (xFramePacerInit(pace, fps)) {
+        PRINT_ERROR("Invalid frame rate %u", fps);
+        goto err_init_events;
+    }
+    atexit(vReportFrames);
+    atexit(vReportFrameTiming);
+
     if (tumEventInit()) {
         PRINT_ERROR("Failed to initialize events");
         goto err_init_events;
@@ -875,106 +1370,90 @@ int main(int argc, char *argv[])
         PRINT_ERROR("Failed to initialize audio");
         goto err_init_audio;
     }
+    atexit(vReportSound);
 
-    buttons.lock = xSemaphoreCreateMutex(); 
-    if (!buttons.lock) {
-        PRINT_ERROR("Failed to create buttons lock");
-        goto err_buttons_lock;
-    }
-
-    ScreenLock = xSemaphoreCreateMutex();
+    ScreenLock = xMainCreateMutex();
     if (!ScreenLock) {
         PRINT_ERROR("Failed to create Screen lock");
         goto err_screen_lock;
     }
 
-    to_AI.lock = xSemaphoreCreateMutex();
+    to_AI.lock = xMainCreateMutex();
     if (!to_AI.lock) {
         PRINT_ERROR("Failed to create to AI data lock");
     }
 
-    from_AI.lock = xSemaphoreCreateMutex();
-    if (!from_AI.lock) {
-        PRINT_ERROR("Failed to create from AI data lock");
-    }
  
-    DrawSignal = xSemaphoreCreateBinary();
+    DrawSignal = xMainCreateBinary();
     if (!DrawSignal) {
         PRINT_ERROR("Failed to create Draw Signal");
         goto err_draw_signal;
     }
 
-    state_machine_signal = xSemaphoreCreateBinary();
-    if (!state_machine_signal) {
-        PRINT_ERROR("Failed to create State Machine Signal");
+    FrameReady = xMainCreateBinary();
+    if (!FrameReady) {
+        PRINT_ERROR("Failed to create Frame Ready signal");
+        goto err_frame_ready;
     }
 
-    next_state_queue = xQueueCreate(1, sizeof(int));
-    if (!next_state_queue) {
-        PRINT_ERROR("Failed to create Next state queue");
-    }
+    // names shown by debuggers and the scheduler trace
+    vQueueAddToRegistry(ScreenLock, "ScreenLock");
+    vQueueAddToRegistry(to_AI.lock, "ToAILock");
+    vQueueAddToRegistry(DrawSignal, "DrawSignal");
+    vQueueAddToRegistry(FrameReady, "FrameReady");
 
-    reset_queue = xQueueCreate(1, sizeof(int));
-    if (!reset_queue) {
-        PRINT_ERROR("Failed to create reset queue");
+#if (configUSE_SCHED_TRACE == 1)
+    if (xSchedTraceStart(SCHED_TRACE_JSON)) {
+        PRINT_ERROR("Failed to start scheduler trace");
     }
+#endif
 
-    cheats_queue = xQueueCreate(4, sizeof(int));
-    if (!cheats_queue) {
-        PRINT_ERROR("Failed to create cheats queue");
-    }
+#if (configUSE_LOCK_PROFILE == 1)
+    atexit(vReportLocks);
+#endif
 
-    nextLvl_queue = xQueueCreate(1, sizeof(int));
-    if (!nextLvl_queue) {
-        PRINT_ERROR("Failed to create next level queue");
-    }
+#if (configUSE_INPUT_LATENCY == 1)
+    atexit(vReportInputLatency);
+#endif
 
-    multipl_queue = xQueueCreate(1, sizeof(int));
-    if (!multipl_queue) {
-        PRINT_ERROR("Failed to create multiplayer queue");
+#if (configUSE_PROF_ZONES == 1)
+    if (xProfZonesStart(PROF_ZONES_CSV)) {
+        PRINT_ERROR("Failed to start profiling zones");
     }
+    atexit(vReportProfZones);
+#endif
 
     // Task Creation ##################################################
 
-    if (xTaskCreate(vSwapBuffers, "", mainGENERIC_STACK_SIZE * 2,
-                NULL, configMAX_PRIORITIES, &bufferswap) != pdPASS) {
+    if (xMainCreateTask(vSwapBuffers, "SwapBuffers",
+                configMAX_PRIORITIES, &bufferswap) != pdPASS) {
         PRINT_TASK_ERROR("swap buffers");
     }
-    if (xTaskCreate(vStateMachine, "", mainGENERIC_STACK_SIZE * 2,
-                NULL, configMAX_PRIORITIES - 1, &statemachine) != pdPASS) {
-        PRINT_TASK_ERROR("state machine");
-    }
-    if (xTaskCreate(vStart_screen, "", mainGENERIC_STACK_SIZE * 2,
-                NULL, mainGENERIC_PRIORITY, &startscreen_task) != pdPASS) {
-        
-        PRINT_TASK_ERROR("startscreen_task");
-    }
-    if (xTaskCreate(vPlay_screen, "", mainGENERIC_STACK_SIZE * 2,
-                NULL, mainGENERIC_PRIORITY, &playscreen_task) != pdPASS) {
-        
-        PRINT_TASK_ERROR("playscreen_task");
+    if (xMainCreateTask(vScreens, "Screens",
+                mainGENERIC_PRIORITY, &screens_task) != pdPASS) {
+        PRINT_TASK_ERROR("screens");
     }
-    if (xTaskCreate(vPauseScreen, "", mainGENERIC_STACK_SIZE * 2,
-                NULL, mainGENERIC_PRIORITY, &pausescreen_task) != pdPASS) {
-        
-        PRINT_TASK_ERROR("pausescreen_task");
+    // at the frame task's priority, so queueing a sample does not switch
+    // to it, samples are played while the frame task waits for DrawSignal
+    if (xMainCreateTask(tumSoundTask, "Sound",
+                mainGENERIC_PRIORITY, &sound_task) != pdPASS) {
+        PRINT_TASK_ERROR("sound");
     }
-    if (xTaskCreate(vCheatView, "", mainGENERIC_STACK_SIZE * 2,
-                NULL, mainGENERIC_PRIORITY, &cheatview_task) != pdPASS) {
-        
-        PRINT_TASK_ERROR("cheatview_task");
-    }
-    if (xTaskCreate(vSendTask, "", mainGENERIC_STACK_SIZE * 2,
-                NULL, configMAX_PRIORITIES - 1, &send_task) != pdPASS) {
+    if (xMainCreateTask(vSendTask, "SendTask",
+                configMAX_PRIORITIES - 1, &send_task) != pdPASS) {
 
         PRINT_TASK_ERROR("send_task");
     }
-    if (xTaskCreate(vReceiveTask, "", mainGENERIC_STACK_SIZE * 2,
-                NULL, configMAX_PRIORITIES - 1, &receive_task) != pdPASS) {
+    if (xMainCreateTask(vReceiveTask, "ReceiveTask",
+                configMAX_PRIORITIES - 1, &receive_task) != pdPASS) {
 
         PRINT_TASK_ERROR("send_task");
     }
 
+    if (xTaskStatsStart(TASK_STATS_PERIOD_MS, TASK_STATS_CSV)) {
+        PRINT_ERROR("Failed to start task statistics");
+    }
+
     // End of Task Creation ##############################################
 
     vTaskStartScheduler();
@@ -982,11 +1461,11 @@ int main(int argc, char *argv[])
     return EXIT_SUCCESS;
 
 
-err_screen_lock:
+err_frame_ready:
     vSemaphoreDelete(DrawSignal);
 err_draw_signal:
-    vSemaphoreDelete(buttons.lock);
-err_buttons_lock:
+    vSemaphoreDelete(ScreenLock);
+err_screen_lock:
     tumSoundExit();
 err_init_audio:
     tumEventExit();
@@ -1008,7 +1487,11 @@ __attribute__((unused)) void vMainQueueSendPassed(void)
 // cppcheck-suppress unusedFunction
 __attribute__((unused)) void vApplicationIdleHook(void)
 {
-#ifdef __GCC_POSIX__
+#if (portUSE_VIRTUAL_TIME == 1)
+    /* Nothing left to run, move on to the next tick right away. */
+    vPortAdvanceVirtualTime();
+#elif defined(__GCC_POSIX__) && (configUSE_TICKLESS_IDLE == 0)
+    /* With tickless idle the port sleeps until the next task wakes up. */
     struct timespec xTimeToSleep, xTimeSlept;
     /* Makes the process more agreeable when using the Posix simulator. */
     xTimeToSleep.tv_sec = 1;
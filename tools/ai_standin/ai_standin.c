@@ -0,0 +1,432 @@
+/**
+ * @file ai_standin.c
+ * @brief Local stand-in for the external AI opponent
+ *
+ * Speaks the same UDP protocol as the AI binary used in multiplayer mode:
+ * the game sends the mothership/player delta x, "ATTACKING"/"PASSIVE",
+ * the difficulty "D<n>" and "PAUSE"/"RESUME" to UDP_TRANSMIT_PORT, the
+ * stand-in answers with "INC"/"DEC" on UDP_RECEIVE_PORT.
+ *
+ * The decision rate as well as an artificial delay, jitter and packet loss
+ * on the commands sent to the game can be configured so that the network
+ * path can be benchmarked reproducibly on a single machine.
+ *
+ * Unless --no-stamp is given, commands carry a sequence number, the send
+ * time and an echo of the latest timestamp received from the game together
+ * with the time it was held, see ai_link.h. This lets the game measure
+ * loss, reordering, round trip time and command staleness.
+ */
+
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Port the game listens on for commands (UDP_RECEIVE_PORT in main.c) */
+#define GAME_PORT 1234
+/** Port the game sends its state to (UDP_TRANSMIT_PORT in main.c) */
+#define AI_PORT 1235
+
+#define BUFFER_SIZE 1000
+#define MAX_PENDING 1024
+
+#define NS_IN_S 1000000000LL
+#define NS_IN_MS 1000000LL
+
+typedef struct pending_cmd {
+	long long due;
+	unsigned int seq;
+	long long echo;
+	long long hold;
+	char msg[32];
+} pending_cmd_t;
+
+static struct {
+	double rate;
+	long long delay;
+	long long jitter;
+	double loss;
+	unsigned int seed;
+	double duration;
+	int verbose;
+	int no_stamp;
+	char *host;
+	unsigned short game_port;
+	unsigned short ai_port;
+} opts = { .rate = 10.0,
+	   .host = "127.0.0.1",
+	   .game_port = GAME_PORT,
+	   .ai_port = AI_PORT };
+
+static struct {
+	int delta_x;
+	int attacking;
+	int difficulty;
+	int paused;
+	int have_state;
+	long long echo;		/**< latest game timestamp, CLOCK_REALTIME */
+	long long echo_received;
+} game = { 0 };
+
+static unsigned int next_seq = 0;
+
+static struct {
+	unsigned long received;
+	unsigned long decisions;
+	unsigned long sent;
+	unsigned long lost;
+	unsigned long overflow;
+} stats = { 0 };
+
+static pending_cmd_t pending[MAX_PENDING];
+static unsigned int pending_count = 0;
+
+static volatile sig_atomic_t quit = 0;
+
+static void onSignal(int sig)
+{
+	quit = 1;
+}
+
+static long long nowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NS_IN_S + ts.tv_nsec;
+}
+
+/** Timestamps exchanged with the game use the wall clock of both sides */
+static long long realNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ts.tv_sec * NS_IN_S + ts.tv_nsec;
+}
+
+static double uniform(void)
+{
+	return rand() / (RAND_MAX + 1.0);
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [options]\n"
+	       "  -r, --rate HZ        decisions per second (default 10)\n"
+	       "  -d, --delay MS       artificial delay of sent commands\n"
+	       "  -j, --jitter MS      uniform +/- jitter added to the delay\n"
+	       "  -l, --loss PCT       percentage of commands dropped\n"
+	       "  -s, --seed N         seed for jitter and loss (default 1)\n"
+	       "  -t, --duration S     exit after S seconds (default: run forever)\n"
+	       "  -H, --host ADDR      address of the game (default 127.0.0.1)\n"
+	       "  -g, --game-port P    port commands are sent to (default %d)\n"
+	       "  -a, --ai-port P      port game state is received on (default %d)\n"
+	       "  -n, --no-stamp       send plain commands like the original AI\n"
+	       "  -v, --verbose        print every received and sent message\n",
+	       name, GAME_PORT, AI_PORT);
+}
+
+static int parseArgs(int argc, char *argv[])
+{
+	static const struct option long_opts[] = {
+		{ "rate", required_argument, NULL, 'r' },
+		{ "delay", required_argument, NULL, 'd' },
+		{ "jitter", required_argument, NULL, 'j' },
+		{ "loss", required_argument, NULL, 'l' },
+		{ "seed", required_argument, NULL, 's' },
+		{ "duration", required_argument, NULL, 't' },
+		{ "host", required_argument, NULL, 'H' },
+		{ "game-port", required_argument, NULL, 'g' },
+		{ "ai-port", required_argument, NULL, 'a' },
+		{ "no-stamp", no_argument, NULL, 'n' },
+		{ "verbose", no_argument, NULL, 'v' },
+		{ "help", no_argument, NULL, 'h' },
+		{ 0 }
+	};
+	int c;
+
+	opts.seed = 1;
+
+	while ((c = getopt_long(argc, argv, "r:d:j:l:s:t:H:g:a:nvh", long_opts,
+				NULL)) != -1) {
+		switch (c) {
+		case 'r':
+			opts.rate = atof(optarg);
+			break;
+		case 'd':
+			opts.delay = atof(optarg) * NS_IN_MS;
+			break;
+		case 'j':
+			opts.jitter = atof(optarg) * NS_IN_MS;
+			break;
+		case 'l':
+			opts.loss = atof(optarg) / 100.0;
+			break;
+		case 's':
+			opts.seed = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			opts.duration = atof(optarg);
+			break;
+		case 'H':
+			opts.host = optarg;
+			break;
+		case 'g':
+			opts.game_port = atoi(optarg);
+			break;
+		case 'a':
+			opts.ai_port = atoi(optarg);
+			break;
+		case 'n':
+			opts.no_stamp = 1;
+			break;
+		case 'v':
+			opts.verbose = 1;
+			break;
+		case 'h':
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (opts.rate <= 0) {
+		fprintf(stderr, "[ERROR] rate must be positive\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+static void handleMessage(char *msg)
+{
+	char *end, *fields;
+	unsigned int seq;
+	long long sent;
+	long value;
+
+	stats.received++;
+
+	if (opts.verbose)
+		printf("<- %s\n", msg);
+
+	fields = strchr(msg, ' ');
+	if (fields) {
+		*fields++ = '\0';
+		if (sscanf(fields, "%u %lld", &seq, &sent) == 2) {
+			game.echo = sent;
+			game.echo_received = nowNs();
+		}
+	}
+
+	if (!strcmp(msg, "PAUSE")) {
+		game.paused = 1;
+	} else if (!strcmp(msg, "RESUME")) {
+		game.paused = 0;
+	} else if (!strcmp(msg, "ATTACKING")) {
+		game.attacking = 1;
+	} else if (!strcmp(msg, "PASSIVE")) {
+		game.attacking = 0;
+	} else if (msg[0] == 'D') {
+		game.difficulty = atoi(msg + 1);
+	} else {
+		value = strtol(msg, &end, 10);
+		if (end != msg) {
+			game.delta_x = value;
+			game.have_state = 1;
+		}
+	}
+}
+
+/**
+ * Follows the player while it is passive and dodges while a
+ * projectile of the player is in flight.
+ */
+static const char *decide(void)
+{
+	int towards_player = game.delta_x > 0 ? 0 : 1;
+
+	if (game.attacking)
+		return towards_player ? "DEC" : "INC";
+
+	return towards_player ? "INC" : "DEC";
+}
+
+static void schedule(const char *msg, long long now)
+{
+	long long delay = opts.delay;
+	unsigned int seq = next_seq++;
+
+	stats.decisions++;
+
+	if (opts.loss > 0 && uniform() < opts.loss) {
+		stats.lost++;
+		return;
+	}
+
+	if (pending_count == MAX_PENDING) {
+		stats.overflow++;
+		return;
+	}
+
+	if (opts.jitter)
+		delay += (long long)((uniform() * 2.0 - 1.0) * opts.jitter);
+	if (delay < 0)
+		delay = 0;
+
+	pending[pending_count].due = now + delay;
+	pending[pending_count].seq = seq;
+	pending[pending_count].echo = game.echo;
+	pending[pending_count].hold = game.echo ? now - game.echo_received : 0;
+	strncpy(pending[pending_count].msg, msg,
+		sizeof(pending[pending_count].msg) - 1);
+	pending_count++;
+}
+
+static void flushDue(int fd, struct sockaddr_in *game_addr, long long now)
+{
+	char msg[96];
+	unsigned int i = 0;
+
+	/** Jitter may reorder commands, exactly like a real network would */
+	while (i < pending_count) {
+		if (pending[i].due > now) {
+			i++;
+			continue;
+		}
+
+		/**
+		 * Stamped after the artificial delay, which thereby counts as
+		 * network latency, whereas the hold time ends at the decision
+		 */
+		if (opts.no_stamp)
+			snprintf(msg, sizeof(msg), "%s", pending[i].msg);
+		else
+			snprintf(msg, sizeof(msg), "%s %u %lld %lld %lld",
+				 pending[i].msg, pending[i].seq, realNs(),
+				 pending[i].echo, pending[i].hold);
+
+		if (sendto(fd, msg, strlen(msg), 0,
+			   (struct sockaddr *)game_addr,
+			   sizeof(*game_addr)) < 0) {
+			fprintf(stderr, "[ERROR] sendto failed: %s\n",
+				strerror(errno));
+		} else {
+			stats.sent++;
+			if (opts.verbose)
+				printf("-> %s\n", msg);
+		}
+
+		pending[i] = pending[--pending_count];
+	}
+}
+
+static long long nextDue(long long next_decision)
+{
+	long long next = next_decision;
+	unsigned int i;
+
+	for (i = 0; i < pending_count; i++)
+		if (pending[i].due < next)
+			next = pending[i].due;
+
+	return next;
+}
+
+int main(int argc, char *argv[])
+{
+	struct sockaddr_in ai_addr = { 0 }, game_addr = { 0 };
+	char buffer[BUFFER_SIZE];
+	long long now, start, period, next_decision, timeout;
+	struct pollfd pfd;
+	ssize_t len;
+	int rx_fd, tx_fd;
+
+	if (parseArgs(argc, argv))
+		return EXIT_FAILURE;
+
+	srand(opts.seed);
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+
+	rx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+	tx_fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (rx_fd < 0 || tx_fd < 0) {
+		fprintf(stderr, "[ERROR] Failed to open sockets: %s\n",
+			strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	ai_addr.sin_family = AF_INET;
+	ai_addr.sin_addr.s_addr = INADDR_ANY;
+	ai_addr.sin_port = htons(opts.ai_port);
+	if (bind(rx_fd, (struct sockaddr *)&ai_addr, sizeof(ai_addr)) < 0) {
+		fprintf(stderr, "[ERROR] Failed to bind port %d: %s\n",
+			opts.ai_port, strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	game_addr.sin_family = AF_INET;
+	game_addr.sin_addr.s_addr = inet_addr(opts.host);
+	game_addr.sin_port = htons(opts.game_port);
+
+	printf("AI stand-in: %.1f Hz, delay %lld ms, jitter %lld ms, loss %.1f%%\n",
+	       opts.rate, opts.delay / NS_IN_MS, opts.jitter / NS_IN_MS,
+	       opts.loss * 100.0);
+
+	period = (long long)(NS_IN_S / opts.rate);
+	start = nowNs();
+	next_decision = start + period;
+
+	pfd.fd = rx_fd;
+	pfd.events = POLLIN;
+
+	while (!quit) {
+		now = nowNs();
+
+		if (opts.duration > 0 && now - start >= opts.duration * NS_IN_S)
+			break;
+
+		timeout = (nextDue(next_decision) - now) / NS_IN_MS;
+		if (timeout < 0)
+			timeout = 0;
+
+		if (poll(&pfd, 1, (int)timeout) > 0 && (pfd.revents & POLLIN)) {
+			while ((len = recv(rx_fd, buffer, sizeof(buffer) - 1,
+					   MSG_DONTWAIT)) > 0) {
+				buffer[len] = '\0';
+				handleMessage(buffer);
+			}
+		}
+
+		now = nowNs();
+
+		/** Absolute deadlines keep the decision rate free of drift */
+		while (now >= next_decision) {
+			if (game.have_state && !game.paused)
+				schedule(decide(), now);
+			next_decision += period;
+		}
+
+		flushDue(tx_fd, &game_addr, now);
+	}
+
+	printf("received %lu, decisions %lu, sent %lu, lost %lu, overflow %lu\n",
+	       stats.received, stats.decisions, stats.sent, stats.lost,
+	       stats.overflow);
+
+	close(rx_fd);
+	close(tx_fd);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+/**
+ * @file switch_bench.c
+ * @brief Context switch latency benchmark for the POSIX port
+ *
+ * Two tasks ping-pong through direct task notifications. The low priority
+ * task stamps the time and notifies the high priority task, which records
+ * how long it took until it actually ran. Every round trip therefore
+ * contains two context switches through vPortYield.
+ *
+ * Built twice by CMake, once per port backend (switch_bench_signal and
+ * switch_bench_futex), so the numbers can be compared directly.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define DEFAULT_ROUNDS 20000
+#define WARMUP_ROUNDS 100
+
+#define NS_IN_S 1000000000LL
+
+static TaskHandle_t pinger = NULL;
+static TaskHandle_t ponger = NULL;
+
+static unsigned int rounds = DEFAULT_ROUNDS;
+static long long *samples;
+static volatile long long stamp;
+
+static long long nowNs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * NS_IN_S + ts.tv_nsec;
+}
+
+static int compareSamples(const void *a, const void *b)
+{
+	long long x = *(const long long *)a, y = *(const long long *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void report(long long elapsed)
+{
+	long long sum = 0;
+	unsigned int i;
+
+	for (i = 0; i < rounds; i++)
+		sum += samples[i];
+
+	qsort(samples, rounds, sizeof(long long), compareSamples);
+
+	printf("backend:   %s\n",
+	       portUSE_FUTEX_SWITCH ? "futex" : "signal");
+	printf("rounds:    %u (%u switches)\n", rounds, rounds * 2);
+	printf("switch ns: min %lld  mean %lld  p50 %lld  p99 %lld  max %lld\n",
+	       samples[0], sum / rounds, samples[rounds / 2],
+	       samples[rounds * 99 / 100], samples[rounds - 1]);
+	printf("round trip ns: %lld\n", elapsed / rounds);
+}
+
+static void vPonger(void *pvParameters)
+{
+	unsigned int i = 0;
+
+	while (1) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+		if (i >= WARMUP_ROUNDS)
+			samples[i - WARMUP_ROUNDS] = nowNs() - stamp;
+		i++;
+	}
+}
+
+static void vPinger(void *pvParameters)
+{
+	long long start = 0;
+	unsigned int i;
+
+	for (i = 0; i < rounds + WARMUP_ROUNDS; i++) {
+		if (i == WARMUP_ROUNDS)
+			start = nowNs();
+
+		stamp = nowNs();
+		/** Ponger has the higher priority, this switches right away */
+		xTaskNotifyGive(ponger);
+	}
+
+	report(nowNs() - start);
+
+	exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc > 1)
+		rounds = strtoul(argv[1], NULL, 0);
+
+	if (!rounds) {
+		fprintf(stderr, "Usage: %s [rounds]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	samples = calloc(rounds, sizeof(long long));
+	if (!samples) {
+		fprintf(stderr, "[ERROR] Failed to allocate samples\n");
+		return EXIT_FAILURE;
+	}
+
+	if (xTaskCreate(vPonger, "ponger", configMINIMAL_STACK_SIZE * 64, NULL,
+			tskIDLE_PRIORITY + 2, &ponger) != pdPASS ||
+	    xTaskCreate(vPinger, "pinger", configMINIMAL_STACK_SIZE * 64, NULL,
+			tskIDLE_PRIORITY + 1, &pinger) != pdPASS) {
+		fprintf(stderr, "[ERROR] Failed to create tasks\n");
+		return EXIT_FAILURE;
+	}
+
+	vTaskStartScheduler();
+
+	return EXIT_FAILURE;
+}
+
+void vMainQueueSendPassed(void)
+{
+}
+
+void vApplicationIdleHook(void)
+{
+}
@@ -0,0 +1,502 @@
+/**
+ * @file tracedump.c
+ * @brief Offline converter for the binary function traces of tracer.c
+ *
+ * Reads the trace file written by a -DTRACE_FUNCTIONS build and resolves
+ * all recorded addresses with a single nm and a single addr2line run,
+ * instead of one addr2line process per event as readtracelog.sh did.
+ *
+ * By default every event is printed in time order:
+ *
+ *   <time us> [<tid>] Enter <function>, called from <caller> (<file:line>)
+ *   <time us> [<tid>] Exit  <function>
+ *
+ * With --summary a flat profile is printed instead: calls, inclusive and
+ * self time per function. Times are wall clock, a function that spans a
+ * FreeRTOS context switch includes the time other tasks ran meanwhile.
+ */
+
+#define _GNU_SOURCE
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "tracer.h"
+
+#define NS_IN_US 1000.0
+#define NS_IN_MS 1000000.0
+
+#define MAX_NAME 256
+#define MAX_DEPTH 1024
+
+typedef struct event {
+	uint64_t time;
+	size_t seq;
+	uint32_t tid;
+	int exit;
+	int32_t func;
+	int32_t caller;
+} event_t;
+
+typedef struct symbol {
+	int32_t offset;
+	char name[MAX_NAME];
+	char line[MAX_NAME];
+} symbol_t;
+
+typedef struct profile {
+	int32_t func;
+	unsigned long calls;
+	uint64_t total;
+	uint64_t self;
+	uint64_t max;
+} profile_t;
+
+typedef struct frame {
+	int32_t func;
+	uint64_t enter;
+	uint64_t children;
+} frame_t;
+
+typedef struct thread_stack {
+	uint32_t tid;
+	unsigned int depth;
+	frame_t frames[MAX_DEPTH];
+} thread_stack_t;
+
+static struct {
+	int summary;
+	char *executable;
+	char *trace;
+} opts = { .trace = TRACE_FILE };
+
+static event_t *events = NULL;
+static size_t event_count = 0;
+static unsigned long dropped = 0;
+
+static symbol_t *symbols = NULL;
+static size_t symbol_count = 0;
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [options] EXECUTABLE [TRACE]\n"
+	       "  -s, --summary        print calls and time per function\n"
+	       "TRACE defaults to %s\n",
+	       name, TRACE_FILE);
+}
+
+static int parseArgs(int argc, char *argv[])
+{
+	static const struct option long_opts[] = {
+		{ "summary", no_argument, NULL, 's' },
+		{ "help", no_argument, NULL, 'h' },
+		{ 0 }
+	};
+	int c;
+
+	while ((c = getopt_long(argc, argv, "sh", long_opts, NULL)) != -1) {
+		switch (c) {
+		case 's':
+			opts.summary = 1;
+			break;
+		case 'h':
+		default:
+			usage(argv[0]);
+			return -1;
+		}
+	}
+
+	if (optind >= argc) {
+		usage(argv[0]);
+		return -1;
+	}
+
+	opts.executable = argv[optind++];
+	if (optind < argc)
+		opts.trace = argv[optind];
+
+	return 0;
+}
+
+static int readTrace(void)
+{
+	trace_file_header_t header;
+	trace_chunk_header_t chunk;
+	trace_record_t record;
+	size_t capacity = 0;
+	FILE *fp;
+	uint32_t i;
+
+	fp = fopen(opts.trace, "rb");
+	if (!fp) {
+		perror(opts.trace);
+		return -1;
+	}
+
+	if (fread(&header, sizeof(header), 1, fp) != 1 ||
+	    memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic))) {
+		fprintf(stderr, "[ERROR] %s is not a function trace\n",
+			opts.trace);
+		fclose(fp);
+		return -1;
+	}
+
+	while (fread(&chunk, sizeof(chunk), 1, fp) == 1) {
+		dropped += chunk.dropped;
+
+		for (i = 0; i < chunk.count; i++) {
+			if (fread(&record, sizeof(record), 1, fp) != 1) {
+				fprintf(stderr, "[WARNING] trace truncated\n");
+				break;
+			}
+
+			if (event_count == capacity) {
+				capacity = capacity ? capacity * 2 : 4096;
+				events = realloc(events,
+						 capacity * sizeof(event_t));
+				if (!events) {
+					fclose(fp);
+					return -1;
+				}
+			}
+
+			events[event_count] = (event_t){
+				.time = record.time & ~TRACE_EXIT_FLAG,
+				.seq = event_count,
+				.tid = chunk.tid,
+				.exit = !!(record.time & TRACE_EXIT_FLAG),
+				.func = record.func,
+				.caller = record.caller,
+			};
+			event_count++;
+		}
+	}
+
+	fclose(fp);
+	return 0;
+}
+
+static int compareEvents(const void *a, const void *b)
+{
+	const event_t *x = a, *y = b;
+
+	if (x->time != y->time)
+		return (x->time > y->time) - (x->time < y->time);
+	/* same timestamp: keep the recorded order within a thread */
+	return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+static int compareOffsets(const void *a, const void *b)
+{
+	int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static symbol_t *findSymbol(int32_t offset)
+{
+	size_t lo = 0, hi = symbol_count;
+
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+
+		if (symbols[mid].offset < offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	if (lo < symbol_count && symbols[lo].offset == offset)
+		return &symbols[lo];
+	return NULL;
+}
+
+static const char *symbolName(int32_t offset)
+{
+	symbol_t *sym = findSymbol(offset);
+
+	return sym ? sym->name : "??";
+}
+
+/** Link time address of TRACE_BASE_SYMBOL, all offsets are relative to it */
+static int findBase(unsigned long long *base)
+{
+	char cmd[512], line[512], type, name[MAX_NAME];
+	unsigned long long addr;
+	int found = 0;
+	FILE *nm;
+
+	snprintf(cmd, sizeof(cmd), "nm '%s'", opts.executable);
+	nm = popen(cmd, "r");
+	if (!nm) {
+		perror("nm");
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), nm)) {
+		if (sscanf(line, "%llx %c %255s", &addr, &type, name) == 3 &&
+		    !strcmp(name, TRACE_BASE_SYMBOL)) {
+			*base = addr;
+			found = 1;
+		}
+	}
+	pclose(nm);
+
+	if (!found) {
+		fprintf(stderr,
+			"[ERROR] %s not found in %s, not a TRACE_FUNCTIONS build?\n",
+			TRACE_BASE_SYMBOL, opts.executable);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void trimNewline(char *str)
+{
+	str[strcspn(str, "\n")] = '\0';
+}
+
+/** Resolves every distinct address with one addr2line invocation */
+static int resolveSymbols(void)
+{
+	char tmp[] = "/tmp/tracedumpXXXXXX";
+	char cmd[512];
+	unsigned long long base = 0;
+	int32_t *offsets;
+	size_t i, n = 0, unique = 0;
+	FILE *fp, *a2l;
+	int fd;
+
+	if (findBase(&base))
+		return -1;
+
+	offsets = malloc(2 * event_count * sizeof(int32_t));
+	if (!offsets)
+		return -1;
+
+	for (i = 0; i < event_count; i++) {
+		offsets[n++] = events[i].func;
+		if (!events[i].exit)
+			offsets[n++] = events[i].caller;
+	}
+
+	qsort(offsets, n, sizeof(int32_t), compareOffsets);
+
+	for (i = 0; i < n; i++) {
+		if (offsets[i] == TRACE_UNKNOWN_OFFSET)
+			continue;
+		if (unique && offsets[unique - 1] == offsets[i])
+			continue;
+		offsets[unique++] = offsets[i];
+	}
+
+	symbols = calloc(unique ? unique : 1, sizeof(symbol_t));
+	if (!symbols) {
+		free(offsets);
+		return -1;
+	}
+
+	for (i = 0; i < unique; i++)
+		symbols[i].offset = offsets[i];
+	symbol_count = unique;
+	free(offsets);
+
+	fd = mkstemp(tmp);
+	if (fd < 0) {
+		perror("mkstemp");
+		return -1;
+	}
+	fp = fdopen(fd, "w");
+	for (i = 0; i < symbol_count; i++)
+		fprintf(fp, "0x%llx\n", base + symbols[i].offset);
+	fclose(fp);
+
+	snprintf(cmd, sizeof(cmd), "addr2line -f -s -e '%s' < %s",
+		 opts.executable, tmp);
+	a2l = popen(cmd, "r");
+	if (!a2l) {
+		perror("addr2line");
+		unlink(tmp);
+		return -1;
+	}
+
+	/* two lines per address: function, file:line */
+	for (i = 0; i < symbol_count; i++) {
+		if (!fgets(symbols[i].name, MAX_NAME, a2l) ||
+		    !fgets(symbols[i].line, MAX_NAME, a2l))
+			break;
+		trimNewline(symbols[i].name);
+		trimNewline(symbols[i].line);
+	}
+
+	pclose(a2l);
+	unlink(tmp);
+
+	return 0;
+}
+
+static void printEvents(void)
+{
+	size_t i;
+
+	for (i = 0; i < event_count; i++) {
+		event_t *e = &events[i];
+		symbol_t *caller;
+
+		if (e->exit) {
+			printf("%12.3f [%u] Exit  %s\n", e->time / NS_IN_US,
+			       e->tid, symbolName(e->func));
+			continue;
+		}
+
+		caller = findSymbol(e->caller);
+		printf("%12.3f [%u] Enter %s, called from %s (%s)\n",
+		       e->time / NS_IN_US, e->tid, symbolName(e->func),
+		       caller ? caller->name : "??",
+		       caller ? caller->line : "??");
+	}
+}
+
+static profile_t *findProfile(profile_t *profiles, int32_t func)
+{
+	symbol_t *sym = findSymbol(func);
+
+	return sym ? &profiles[sym - symbols] : NULL;
+}
+
+static thread_stack_t *findStack(thread_stack_t **stacks, size_t *count,
+				 uint32_t tid)
+{
+	size_t i;
+
+	for (i = 0; i < *count; i++)
+		if ((*stacks)[i].tid == tid)
+			return &(*stacks)[i];
+
+	*stacks = realloc(*stacks, (*count + 1) * sizeof(thread_stack_t));
+	if (!*stacks)
+		return NULL;
+
+	(*stacks)[*count].tid = tid;
+	(*stacks)[*count].depth = 0;
+	return &(*stacks)[(*count)++];
+}
+
+static int compareProfiles(const void *a, const void *b)
+{
+	const profile_t *x = a, *y = b;
+
+	return (x->total < y->total) - (x->total > y->total);
+}
+
+static void printSummary(void)
+{
+	thread_stack_t *stacks = NULL, *stack;
+	size_t stack_count = 0, i;
+	unsigned long unmatched = 0;
+	profile_t *profiles, *p;
+	unsigned int depth;
+	uint64_t elapsed;
+
+	profiles = calloc(symbol_count ? symbol_count : 1, sizeof(profile_t));
+	if (!profiles)
+		return;
+	for (i = 0; i < symbol_count; i++)
+		profiles[i].func = symbols[i].offset;
+
+	for (i = 0; i < event_count; i++) {
+		event_t *e = &events[i];
+
+		stack = findStack(&stacks, &stack_count, e->tid);
+		if (!stack)
+			return;
+
+		if (!e->exit) {
+			if (stack->depth == MAX_DEPTH) {
+				unmatched++;
+				continue;
+			}
+			stack->frames[stack->depth++] = (frame_t){
+				.func = e->func, .enter = e->time
+			};
+			continue;
+		}
+
+		/*
+		 * Dropped events leave unbalanced frames behind, unwind
+		 * to the matching entry or ignore the exit.
+		 */
+		for (depth = stack->depth; depth; depth--)
+			if (stack->frames[depth - 1].func == e->func)
+				break;
+		if (!depth) {
+			unmatched++;
+			continue;
+		}
+		unmatched += stack->depth - depth;
+		stack->depth = depth - 1;
+
+		elapsed = e->time - stack->frames[depth - 1].enter;
+		p = findProfile(profiles, e->func);
+		if (p) {
+			p->calls++;
+			p->total += elapsed;
+			p->self += elapsed - stack->frames[depth - 1].children;
+			if (elapsed > p->max)
+				p->max = elapsed;
+		}
+		if (stack->depth)
+			stack->frames[stack->depth - 1].children += elapsed;
+	}
+
+	qsort(profiles, symbol_count, sizeof(profile_t), compareProfiles);
+
+	printf("%10s %12s %12s %12s  %s\n", "calls", "total ms", "self ms",
+	       "max us", "function");
+	for (i = 0; i < symbol_count; i++) {
+		p = &profiles[i];
+		if (!p->calls)
+			continue;
+		printf("%10lu %12.3f %12.3f %12.3f  %s\n", p->calls,
+		       p->total / NS_IN_MS, p->self / NS_IN_MS,
+		       p->max / NS_IN_US, symbolName(p->func));
+	}
+
+	if (unmatched)
+		printf("%lu unmatched entries or exits\n", unmatched);
+
+	free(profiles);
+	free(stacks);
+}
+
+int main(int argc, char *argv[])
+{
+	if (parseArgs(argc, argv))
+		return EXIT_FAILURE;
+
+	if (readTrace())
+		return EXIT_FAILURE;
+
+	qsort(events, event_count, sizeof(event_t), compareEvents);
+
+	if (resolveSymbols())
+		return EXIT_FAILURE;
+
+	if (opts.summary)
+		printSummary();
+	else
+		printEvents();
+
+	if (dropped)
+		fprintf(stderr, "[WARNING] %lu events were dropped\n", dropped);
+
+	free(symbols);
+	free(events);
+
+	return EXIT_SUCCESS;
+}